@@ -0,0 +1,115 @@
+// Checks that scanning a source in parallel chunks gives the same tokens as
+// scanning it in one go.
+//
+//   g++ -O2 bench/scan_chunks_check.cpp -o scan_chunks_check
+//   ./scan_chunks_check bench/scan_corpus/*.lox
+//
+// Chunks are only used for sources of at least 2 * Scanner::MIN_CHUNK, so each
+// file is repeated up to a few times that. It is shifted by a few bytes at a
+// time so that the chunk splits land in different places, and scanned on a
+// few thread counts. The corpus is mostly strings and block comments that
+// run over lines starting with text, which is where a split can fall inside
+// a token. How many splits did is printed at the end.
+
+#include <algorithm>
+
+#include "../src/types.hpp"
+#include "../src/error.hpp"
+#include "../src/scanner.cpp"
+
+// the same splits Scanner::scanChunks makes
+std::vector<size_t> splits(std::string_view source, unsigned threads) {
+    size_t count = std::min<size_t>(threads, source.length() / Scanner::MIN_CHUNK);
+    std::vector<size_t> bounds = {0};
+    for (size_t i = 1; i < count; i++) {
+        size_t split = std::max(bounds.back() + 1, source.length() / count * i);
+        while (split < source.length() && !(source[split - 1] == '\n' && !kernels::isBlank(source[split])))
+            split++;
+        if (split < source.length()) bounds.push_back(split);
+    }
+    return std::vector<size_t>(bounds.begin() + 1, bounds.end());
+}
+
+struct Crossings {
+    size_t splits = 0;
+    size_t strings = 0;
+    size_t comments = 0;
+};
+
+// what each split fell in, going by the tokens of the serial scan
+void classify(std::string_view source, const std::vector<Token>& tokens, unsigned threads, Crossings& crossings) {
+    for (size_t split : splits(source, threads)) {
+        crossings.splits++;
+        const char* at = source.data() + split;
+        auto it = std::lower_bound(tokens.begin(), tokens.end(), at,
+                                   [](const Token& token, const char* at) { return token.start < at; });
+        if (it != tokens.end() && it->start == at) continue;
+        if (it != tokens.begin() && (it - 1)->start + (it - 1)->length > at) crossings.strings++;
+        else if (source.substr(split, 2) != "//" && source.substr(split, 2) != "/*") crossings.comments++;
+    }
+}
+
+bool same(const Token& a, const Token& b) {
+    return a.type == b.type && a.start == b.start && a.length == b.length && a.line == b.line;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: scan_chunks_check file.lox..." << std::endl;
+        return 1;
+    }
+
+    const unsigned threadCounts[] = {2, 3, 4, 7};
+    const size_t shifts[] = {0, 1, 2, 5, 13, 29, 61, 127};
+    Crossings crossings;
+    int failures = 0;
+
+    for (int f = 1; f < argc; f++) {
+        std::ifstream file(argv[f], std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << argv[f] << std::endl;
+            return 1;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        std::string text = contents.str();
+        if (text.empty()) continue;
+
+        for (size_t shift : shifts) {
+            // a line comment in front moves everything after it
+            std::string source = shift == 0 ? "" : "//" + std::string(shift > 2 ? shift - 2 : 0, '-') + "\n";
+            while (source.size() < 5 * Scanner::MIN_CHUNK) source += text;
+
+            std::vector<Token> serial = Scanner(source).scanTokens();
+            for (unsigned threads : threadCounts) {
+                Scanner scanner(source);
+                scanner.threads = threads;
+                std::vector<Token> chunked = scanner.scanTokens();
+                classify(source, serial, threads, crossings);
+
+                size_t i = 0;
+                while (i < serial.size() && i < chunked.size() && same(serial[i], chunked[i])) i++;
+                if (i == serial.size() && i == chunked.size()) continue;
+
+                failures++;
+                std::cerr << argv[f] << ", shifted " << shift << ", " << threads << " threads: ";
+                if (i == serial.size() || i == chunked.size()) {
+                    std::cerr << serial.size() << " tokens serially, " << chunked.size() << " in chunks" << std::endl;
+                } else {
+                    std::cerr << "token " << i << " is '" << serial[i].lexeme() << "' on line " << serial[i].line
+                              << " serially, '" << chunked[i].lexeme() << "' on line " << chunked[i].line
+                              << " in chunks" << std::endl;
+                }
+            }
+        }
+    }
+
+    std::cout << crossings.splits << " splits, " << crossings.strings << " inside strings, "
+              << crossings.comments << " inside comments" << std::endl;
+    if (failures > 0) {
+        std::cout << failures << " runs differ" << std::endl;
+        return 1;
+    }
+    std::cout << "chunked scans match" << std::endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Scanner throughput: the scanner from before the scanner work, then the
+// current one with its scalar kernels and with the SIMD ones.
+//
+//   g++ -O2 bench/scanner_bench.cpp -o scanner_bench            (SSE2)
+//   g++ -O2 -mavx2 bench/scanner_bench.cpp -o scanner_bench     (AVX2)
+//   ./scanner_bench [file.lox] [iterations]
+//
+// Without a file it scans a generated mix of comments, strings, identifiers
+// and numbers.
+
+#include <chrono>
+
+#include "../src/types.hpp"
+#include "../src/error.hpp"
+#include "../src/scanner.cpp"
+#include "baseline_scanner.hpp"
+
+std::string generate(size_t size) {
+    std::string source;
+    int i = 0;
+    while (source.size() < size) {
+        source += "// helper number " + std::to_string(i) + ", generated for the scanner benchmark\n";
+        source += "fun helperFunction" + std::to_string(i) + "(argumentOne, argumentTwo) {\n";
+        source += "    var accumulated = argumentOne * 31415.9265 + argumentTwo;\n";
+        source += "    print \"a reasonably long string literal in the body of the helper\";\n";
+        source += "    return accumulated - 1000000;\n";
+        source += "}\n\n";
+        i++;
+    }
+    return source;
+}
+
+double scanBaseline(const std::string& source, int iterations, size_t& count) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        baseline::Scanner scanner(source);
+        count = scanner.scanTokens().size();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return source.size() * (double)iterations / elapsed.count() / (1024 * 1024);
+}
+
+double scan(const std::string& source, bool vectorized, int iterations, size_t& count) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        Scanner scanner(source, vectorized);
+        count = scanner.scanTokens().size();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return source.size() * (double)iterations / elapsed.count() / (1024 * 1024);
+}
+
+int main(int argc, char* argv[]) {
+    std::string source;
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << argv[1] << std::endl;
+            return 1;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        source = contents.str();
+    } else {
+        source = generate(16 * 1024 * 1024);
+    }
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    size_t baselineTokens, scalarTokens, vectorTokens;
+    double baseline = scanBaseline(source, iterations, baselineTokens);
+    double scalar = scan(source, false, iterations, scalarTokens);
+    double vector = scan(source, true, iterations, vectorTokens);
+
+    std::cout << "input:  " << source.size() / 1024 << " KiB, " << vectorTokens << " tokens\n";
+    std::cout << "baseline: " << baseline << " MB/s\n";
+    std::cout << "scalar:   " << scalar << " MB/s (" << scalar / baseline << "x)\n";
+    std::cout << "simd:     " << vector << " MB/s (" << vector / baseline << "x, " << vector / scalar << "x scalar)\n";
+    if (baselineTokens != scalarTokens || scalarTokens != vectorTokens) {
+        std::cerr << "token counts differ: " << baselineTokens << ", " << scalarTokens << " and " << vectorTokens << std::endl;
+        return 1;
+    }
+    return 0;
+}
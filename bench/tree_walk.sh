@@ -0,0 +1,25 @@
+#!/bin/bash
+# Tree-walk throughput: wall time of each benchmark script, best of N runs.
+#
+#   bench/tree_walk.sh ./lox [./lox-before] [runs]
+#
+# With two binaries both are timed on the same scripts.
+
+runs=${3:-3}
+dir=$(cd "$(dirname "$0")" && pwd)
+scripts="$dir/../src/a.lox $dir/../src/m.lox $dir/loop.lox"
+
+best() {
+    local TIMEFORMAT=%R
+    for run in $(seq "$runs"); do
+        { time "$1" "$2" > /dev/null 2>&1; } 2>&1
+    done | sort -n | head -1
+}
+
+for script in $scripts; do
+    line="$(basename "$script"):"
+    for lox in "$1" $2; do
+        line="$line  $lox $(best "$lox" "$script")s"
+    done
+    echo "$line"
+done
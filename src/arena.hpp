@@ -0,0 +1,79 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bump-pointer allocator. Everything allocated from an arena is released at
+// once when the arena goes away, without running destructors, so only
+// trivially destructible objects (like AST nodes and their Lists) go in it.
+class Arena {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (char* block : blocks) delete[] block;
+    }
+
+    void* allocate(size_t size, size_t align) {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t)(align - 1);
+        if (cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+            size_t blockSize = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+            char* block = new char[blockSize];
+            blocks.push_back(block);
+            cursor = block;
+            limit = block + blockSize;
+            aligned = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        cursor = reinterpret_cast<char*>(aligned + size);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Releases everything allocated so far, keeping the first block for reuse.
+    void reset() {
+        if (blocks.empty()) return;
+        for (size_t i = 1; i < blocks.size(); i++) delete[] blocks[i];
+        blocks.resize(1);
+        cursor = blocks[0];
+        limit = blocks[0] + BLOCK_SIZE;
+    }
+
+private:
+    std::vector<char*> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+};
+
+inline void* operator new(size_t size, Arena& arena) {
+    return arena.allocate(size, alignof(std::max_align_t));
+}
+
+// Fixed-size array of nodes, allocated in the arena of its unit.
+template <class T>
+class List {
+public:
+    List() : items(nullptr), count(0) {}
+
+    List(Arena& arena, const std::vector<T>& from) : count(from.size()) {
+        items = static_cast<T*>(arena.allocate(sizeof(T) * count, alignof(T)));
+        for (uint32_t i = 0; i < count; i++) new (&items[i]) T(from[i]);
+    }
+
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) const { return items[i]; }
+    T& at(size_t i) const { return items[i]; }
+
+private:
+    T* items;
+    uint32_t count;
+};
+
+#endif //ARENA_H_
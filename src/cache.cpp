@@ -0,0 +1,728 @@
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+
+#include "cache.hpp"
+
+static const char MAGIC[4] = {'L', 'O', 'X', 'C'};
+// stands in for a missing expression or statement
+static const uint8_t NONE = 0xFF;
+// an upvalue not known to hold a function
+static const uint64_t NO_FUNCTION = UINT64_MAX;
+
+
+class ScriptCache::Writer {
+public:
+    explicit Writer(CompilationUnit& unit) : unit(unit), base(unit.source->text()) {}
+
+    std::string out;
+
+    template <class T>
+    void put(T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void bytes(std::string_view text) {
+        put<uint32_t>(text.size());
+        out.append(text);
+    }
+
+    void token(const Token& token) {
+        // only tokens that point into the source can be written as offsets
+        if (token.start < base.data() || token.start + token.length > base.data() + base.size())
+            throw Corrupt();
+        put<uint8_t>(static_cast<uint8_t>(token.type));
+        put<uint64_t>(token.start - base.data());
+        put<uint32_t>(token.length);
+        put<int32_t>(token.line);
+    }
+
+    // a temporary a pass added has no place in the source, only a line
+    void name(const Name& name) {
+        put<uint8_t>(name.isTemporary());
+        if (name.isTemporary()) put<int32_t>(name.line);
+        else token(name);
+    }
+
+    void constant(Value value) {
+        auto it = constantIds.find(value.raw());
+        if (it == constantIds.end()) {
+            it = constantIds.emplace(value.raw(), constants.size()).first;
+            constants.push_back(value);
+        }
+        put<uint32_t>(it->second);
+    }
+
+    void lazy(LazyBody* body) {
+        auto it = lazyIds.find(body);
+        if (it == lazyIds.end()) throw Corrupt();
+        put<uint32_t>(it->second);
+    }
+
+    // a declaration of the unit, by the offset of its name
+    void function(FunctionStmt* function) {
+        put<uint8_t>(function != nullptr);
+        if (function == nullptr) return;
+        const char* start = function->name.start;
+        if (start < base.data() || start > base.data() + base.size()) throw Corrupt();
+        put<uint64_t>(start - base.data());
+    }
+
+    void expr(Expr* expr) {
+        if (expr == nullptr) return put<uint8_t>(NONE);
+        put<uint8_t>(static_cast<uint8_t>(expr->kind));
+        switch (expr->kind) {
+            case ExprKind::BINARY: {
+                Binary* binary = static_cast<Binary*>(expr);
+                this->expr(binary->left);
+                token(binary->oper);
+                this->expr(binary->right);
+                put<uint8_t>(binary->numeric);
+                break;
+            }
+            case ExprKind::GROUPING:
+                this->expr(static_cast<Grouping*>(expr)->expression);
+                break;
+            case ExprKind::LITERAL:
+                constant(static_cast<Literal*>(expr)->value);
+                break;
+            case ExprKind::CALL: {
+                Call* call = static_cast<Call*>(expr);
+                this->expr(call->callee);
+                token(call->paren);
+                put<uint32_t>(call->arguments.size());
+                for (Expr* argument : call->arguments) this->expr(argument);
+                break;
+            }
+            case ExprKind::UNARY: {
+                Unary* unary = static_cast<Unary*>(expr);
+                token(unary->oper);
+                this->expr(unary->right);
+                break;
+            }
+            case ExprKind::VARIABLE: {
+                Variable* variable = static_cast<Variable*>(expr);
+                name(variable->name);
+                put<uint8_t>(static_cast<uint8_t>(variable->access));
+                put<int32_t>(variable->slot);
+                break;
+            }
+            case ExprKind::ASSIGN: {
+                Assign* assign = static_cast<Assign*>(expr);
+                name(assign->name);
+                this->expr(assign->value);
+                put<uint8_t>(static_cast<uint8_t>(assign->access));
+                put<int32_t>(assign->slot);
+                break;
+            }
+            case ExprKind::LOGICAL: {
+                Logical* logical = static_cast<Logical*>(expr);
+                this->expr(logical->left);
+                token(logical->oper);
+                this->expr(logical->right);
+                break;
+            }
+            case ExprKind::INLINE: {
+                Inline* inlined = static_cast<Inline*>(expr);
+                this->expr(inlined->call);
+                function(inlined->function);
+                put<uint32_t>(inlined->base);
+                this->expr(inlined->body);
+                break;
+            }
+        }
+    }
+
+    void stmt(Statement* stmt) {
+        if (stmt == nullptr) return put<uint8_t>(NONE);
+        put<uint8_t>(static_cast<uint8_t>(stmt->kind));
+        switch (stmt->kind) {
+            case StmtKind::PRINT:
+                expr(static_cast<PrintStmt*>(stmt)->expression);
+                break;
+            case StmtKind::EXPR:
+                expr(static_cast<ExprStmt*>(stmt)->expression);
+                break;
+            case StmtKind::VAR: {
+                VarStmt* var = static_cast<VarStmt*>(stmt);
+                name(var->name);
+                expr(var->initializer);
+                put<uint8_t>(static_cast<uint8_t>(var->access));
+                put<int32_t>(var->slot);
+                break;
+            }
+            case StmtKind::BLOCK:
+                statements(static_cast<BlockStmt*>(stmt)->statements);
+                break;
+            case StmtKind::IF: {
+                IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+                expr(ifStmt->condition);
+                this->stmt(ifStmt->thenBranch);
+                this->stmt(ifStmt->elseBranch);
+                break;
+            }
+            case StmtKind::WHILE: {
+                WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+                expr(whileStmt->condition);
+                this->stmt(whileStmt->body);
+                break;
+            }
+            case StmtKind::FUNCTION: {
+                FunctionStmt* function = static_cast<FunctionStmt*>(stmt);
+                name(function->name);
+                put<uint32_t>(function->params.size());
+                for (const Name& param : function->params) name(param);
+                put<uint8_t>(static_cast<uint8_t>(function->access));
+                put<int32_t>(function->slot);
+                put<uint32_t>(function->locals);
+                put<uint32_t>(function->upvalues.size());
+                for (const Upvalue& upvalue : function->upvalues) {
+                    put<uint8_t>(upvalue.local);
+                    put<uint32_t>(upvalue.index);
+                    bytes(symbols.name(upvalue.name));
+                    this->function(upvalue.function);
+                }
+                put<uint32_t>(function->cellParams.size());
+                for (bool cell : function->cellParams) put<uint8_t>(cell);
+                put<uint8_t>(function->pure);
+                put<uint32_t>(function->callees.size());
+                for (FunctionStmt* callee : function->callees) this->function(callee);
+                put<uint8_t>(function->lazy != nullptr);
+                if (function->lazy != nullptr) lazy(function->lazy);
+                else statements(function->body);
+                break;
+            }
+            case StmtKind::RETURN: {
+                ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+                token(returnStmt->keyword);
+                expr(returnStmt->value);
+                put<uint8_t>(returnStmt->tailCall);
+                break;
+            }
+            case StmtKind::IMPORT: {
+                ImportStmt* import = static_cast<ImportStmt*>(stmt);
+                token(import->keyword);
+                token(import->path);
+                break;
+            }
+        }
+    }
+
+    void statements(const List<Statement*>& statements) {
+        put<uint32_t>(statements.size());
+        for (Statement* statement : statements) stmt(statement);
+    }
+
+    // The bodies and constants the AST refers to, numbered so that the AST
+    // can be written first and the tables put in front of it afterwards.
+    std::string tables() {
+        Writer header(unit);
+        header.put<uint32_t>(unit.locals);
+
+        header.put<uint32_t>(unit.lazyBodies.size());
+        for (const LazyBody& body : unit.lazyBodies) {
+            header.put<uint64_t>(body.offset);
+            header.put<int32_t>(body.line);
+            header.put<uint8_t>(body.expression);
+        }
+
+        header.put<uint32_t>(constants.size());
+        for (Value value : constants) {
+            header.put<uint8_t>(static_cast<uint8_t>(value.type()));
+            switch (value.type()) {
+                case ValueType::NUMBER: header.put<double>(value.number()); break;
+                case ValueType::STRING: header.bytes(value.str()); break;
+                case ValueType::BOOLEAN: header.put<uint8_t>(value.boolean()); break;
+                case ValueType::NIL: break;
+                default: throw Corrupt();
+            }
+        }
+        return header.out;
+    }
+
+    void numberLazyBodies() {
+        for (LazyBody& body : unit.lazyBodies) lazyIds.emplace(&body, lazyIds.size());
+    }
+
+private:
+    CompilationUnit& unit;
+    std::string_view base;
+    // by their bits, as equal string literals share their text
+    std::unordered_map<uint64_t, uint32_t> constantIds;
+    std::vector<Value> constants;
+    std::unordered_map<LazyBody*, uint32_t> lazyIds;
+};
+
+
+class ScriptCache::Reader {
+public:
+    Reader(std::string_view data, CompilationUnit& unit)
+        : p(data.data()), end(data.data() + data.size()), unit(unit), arena(unit.arena),
+          base(unit.source->text()) {}
+
+    const char* p;
+    const char* end;
+
+    template <class T>
+    T get() {
+        if (size_t(end - p) < sizeof(T)) throw Corrupt();
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    // a count of items that each take at least one byte
+    uint32_t count() {
+        uint32_t n = get<uint32_t>();
+        if (n > size_t(end - p)) throw Corrupt();
+        return n;
+    }
+
+    std::string_view bytes() {
+        uint32_t length = count();
+        std::string_view text(p, length);
+        p += length;
+        return text;
+    }
+
+    Token token() {
+        uint8_t type = get<uint8_t>();
+        uint64_t offset = get<uint64_t>();
+        uint32_t length = get<uint32_t>();
+        int32_t line = get<int32_t>();
+        if (type > static_cast<uint8_t>(TokenType::EOF_) || length > Token::MAX_LENGTH
+            || offset > base.size() || length > base.size() - offset)
+            throw Corrupt();
+        return Token(static_cast<TokenType>(type), base.data() + offset, length, line);
+    }
+
+    Name name() {
+        if (get<uint8_t>() != 0) return Name::temporary(get<int32_t>());
+        return Name(token());
+    }
+
+    void tables() {
+        unit.locals = frameSize();
+        frame.locals = unit.locals;
+
+        uint32_t lazyCount = count();
+        for (uint32_t i = 0; i < lazyCount; i++) {
+            LazyBody& body = unit.lazyBodies.emplace_back();
+            body.offset = get<uint64_t>();
+            body.line = get<int32_t>();
+            body.expression = get<uint8_t>() != 0;
+            if (body.offset >= base.size() || base[body.offset] != '{') throw Corrupt();
+            lazies.push_back(&body);
+        }
+
+        uint32_t constantCount = count();
+        for (uint32_t i = 0; i < constantCount; i++) {
+            switch (static_cast<ValueType>(get<uint8_t>())) {
+                case ValueType::NUMBER: constants.push_back(unit.constants.number(get<double>())); break;
+                case ValueType::STRING: constants.push_back(unit.constants.string(bytes())); break;
+                case ValueType::BOOLEAN: constants.push_back(unit.constants.boolean(get<uint8_t>() != 0)); break;
+                case ValueType::NIL: constants.push_back(unit.constants.nil()); break;
+                default: throw Corrupt();
+            }
+        }
+    }
+
+    // filled in by resolveFunctions(), as it may come before the declaration
+    void function(FunctionStmt** function) {
+        *function = nullptr;
+        if (get<uint8_t>()) fixups.emplace_back(function, get<uint64_t>());
+    }
+
+    void resolveFunctions() {
+        for (auto& [function, offset] : fixups) {
+            auto it = functions.find(offset);
+            if (it == functions.end()) throw Corrupt();
+            *function = it->second;
+        }
+        // an inlined body sees the upvalues of the function it came from
+        for (auto& [inlined, upvalues] : inlines) {
+            FunctionStmt* function = inlined->function;
+            if (function == nullptr) continue;
+            if (upvalues > function->upvalues.size() || inlined->call->arguments.size() != function->params.size())
+                throw Corrupt();
+        }
+    }
+
+    // one the node can't do without
+    Expr* required() {
+        Expr* node = expr();
+        if (node == nullptr) throw Corrupt();
+        return node;
+    }
+
+    Statement* requiredStmt() {
+        Statement* node = stmt();
+        if (node == nullptr) throw Corrupt();
+        return node;
+    }
+
+    Expr* expr() {
+        uint8_t kind = get<uint8_t>();
+        if (kind == NONE) return nullptr;
+        switch (static_cast<ExprKind>(kind)) {
+            case ExprKind::BINARY: {
+                Expr* left = required();
+                Token oper = token();
+                Binary* binary = new (arena) Binary(left, oper, required());
+                binary->numeric = get<uint8_t>() != 0;
+                return binary;
+            }
+            case ExprKind::GROUPING:
+                return new (arena) Grouping(required());
+            case ExprKind::LITERAL: {
+                uint32_t id = get<uint32_t>();
+                if (id >= constants.size()) throw Corrupt();
+                return new (arena) Literal(constants[id]);
+            }
+            case ExprKind::CALL: {
+                Expr* callee = required();
+                Token paren = token();
+                uint32_t n = count();
+                std::vector<Expr*> arguments;
+                for (uint32_t i = 0; i < n; i++) arguments.push_back(required());
+                return new (arena) Call(callee, paren, List<Expr*>(arena, arguments));
+            }
+            case ExprKind::UNARY: {
+                Token oper = token();
+                return new (arena) Unary(oper, required());
+            }
+            case ExprKind::VARIABLE: {
+                Variable* variable = new (arena) Variable(name());
+                variable->access = access();
+                variable->slot = get<int32_t>();
+                if (variable->access == Access::GLOBAL) variable->slot = global(variable->name);
+                else slot(variable->access, variable->slot);
+                return variable;
+            }
+            case ExprKind::ASSIGN: {
+                Name target = name();
+                Assign* assign = new (arena) Assign(target, required());
+                assign->access = access();
+                assign->slot = get<int32_t>();
+                if (assign->access == Access::GLOBAL) {
+                    assign->slot = global(assign->name);
+                    // as the Resolver does
+                    auto it = unit.functions.find(assign->slot);
+                    if (it != unit.functions.end()) it->second = nullptr;
+                } else {
+                    slot(assign->access, assign->slot);
+                }
+                return assign;
+            }
+            case ExprKind::LOGICAL: {
+                Expr* left = required();
+                Token oper = token();
+                return new (arena) Logical(left, oper, required());
+            }
+            case ExprKind::INLINE: {
+                Expr* call = expr();
+                if (call == nullptr || call->kind != ExprKind::CALL) throw Corrupt();
+                Inline* inlined = new (arena) Inline(static_cast<Call*>(call), nullptr, 0, nullptr);
+                function(&inlined->function);
+                inlined->base = get<uint32_t>();
+                // the arguments are put in this frame from base on
+                if (inlined->base > frame.locals || inlined->call->arguments.size() > frame.locals - inlined->base)
+                    throw Corrupt();
+                for (size_t i = 0; i < inlined->call->arguments.size(); i++) define(Access::LOCAL, inlined->base + i);
+                uint32_t upvalues = frame.upvalues;
+                bool outer = frame.inlined;
+                frame.upvalues = 0;
+                frame.inlined = true;
+                inlined->body = required();
+                inlines.emplace_back(inlined, frame.upvalues);
+                frame.upvalues = upvalues;
+                frame.inlined = outer;
+                return inlined;
+            }
+        }
+        throw Corrupt();
+    }
+
+    Statement* stmt() {
+        uint8_t kind = get<uint8_t>();
+        if (kind == NONE) return nullptr;
+        switch (static_cast<StmtKind>(kind)) {
+            case StmtKind::PRINT:
+                return new (arena) PrintStmt(required());
+            case StmtKind::EXPR:
+                return new (arena) ExprStmt(required());
+            case StmtKind::VAR: {
+                Name target = name();
+                VarStmt* var = new (arena) VarStmt(target, expr());
+                var->access = access();
+                var->slot = get<int32_t>();
+                if (var->access == Access::GLOBAL) var->slot = global(var->name);
+                else define(var->access, var->slot);
+                return var;
+            }
+            case StmtKind::BLOCK:
+                return new (arena) BlockStmt(statements());
+            case StmtKind::IF: {
+                Expr* condition = required();
+                Statement* thenBranch = requiredStmt();
+                return new (arena) IfStmt(condition, thenBranch, stmt());
+            }
+            case StmtKind::WHILE: {
+                Expr* condition = required();
+                return new (arena) WhileStmt(condition, requiredStmt());
+            }
+            case StmtKind::FUNCTION: {
+                Name function = name();
+                uint32_t n = count();
+                std::vector<Name> params;
+                for (uint32_t i = 0; i < n; i++) params.push_back(name());
+                Access access = this->access();
+                int slot = get<int32_t>();
+                if (access == Access::GLOBAL) slot = global(function);
+                else define(access, slot);
+                uint32_t locals = frameSize();
+                uint32_t captures = count();
+                std::vector<Upvalue> upvalues;
+                std::vector<uint64_t> targets;
+                for (uint32_t i = 0; i < captures; i++) {
+                    bool local = get<uint8_t>() != 0;
+                    uint32_t index = get<uint32_t>();
+                    // taken from the frame it is declared in
+                    this->slot(local ? Access::CELL : Access::UPVALUE, index);
+                    // its function, if it has one, is filled in by resolveFunctions()
+                    upvalues.push_back({local, index, symbols.intern(bytes()), nullptr});
+                    targets.push_back(get<uint8_t>() != 0 ? get<uint64_t>() : NO_FUNCTION);
+                }
+                uint32_t cells = count();
+                std::vector<bool> cellParams;
+                for (uint32_t i = 0; i < cells; i++) cellParams.push_back(get<uint8_t>() != 0);
+                bool pure = get<uint8_t>() != 0;
+                uint32_t called = count();
+                std::vector<uint64_t> callees;
+                for (uint32_t i = 0; i < called; i++) callees.push_back(get<uint8_t>() != 0 ? get<uint64_t>() : NO_FUNCTION);
+                FunctionStmt* declaration;
+                if (get<uint8_t>()) {
+                    uint32_t id = get<uint32_t>();
+                    // a pre-parsed body is resolved when it is compiled
+                    if (id >= lazies.size() || cells != 0) throw Corrupt();
+                    declaration = new (arena) FunctionStmt(function, List<Name>(arena, params), List<Statement*>(), &unit, lazies[id]);
+                } else {
+                    // the parameters take the first slots of the frame
+                    if (cells != n || n > locals) throw Corrupt();
+                    Frame outer = std::move(frame);
+                    frame = Frame{locals, captures, false, {}};
+                    for (uint32_t i = 0; i < n; i++) define(cellParams[i] ? Access::CELL : Access::LOCAL, i);
+                    List<Statement*> body = statements();
+                    frame = std::move(outer);
+                    declaration = new (arena) FunctionStmt(function, List<Name>(arena, params), body, &unit);
+                }
+                declaration->access = access;
+                declaration->slot = slot;
+                declaration->locals = locals;
+                declaration->upvalues = List<Upvalue>(arena, upvalues);
+                for (uint32_t i = 0; i < captures; i++) {
+                    if (targets[i] != NO_FUNCTION) fixups.emplace_back(&declaration->upvalues[i].function, targets[i]);
+                }
+                declaration->cellParams = List<bool>(arena, cellParams);
+                declaration->pure = pure;
+                declaration->callees = List<FunctionStmt*>(arena, std::vector<FunctionStmt*>(called));
+                for (uint32_t i = 0; i < called; i++) {
+                    if (callees[i] == NO_FUNCTION) throw Corrupt();
+                    fixups.emplace_back(&declaration->callees[i], callees[i]);
+                }
+                functions[function.start - base.data()] = declaration;
+                if (access == Access::GLOBAL) unit.functions[slot] = declaration;
+                return declaration;
+            }
+            case StmtKind::RETURN: {
+                Token keyword = token();
+                ReturnStmt* returnStmt = new (arena) ReturnStmt(keyword, expr());
+                returnStmt->tailCall = get<uint8_t>() != 0;
+                if (returnStmt->tailCall && (returnStmt->value == nullptr || returnStmt->value->kind != ExprKind::CALL))
+                    throw Corrupt();
+                return returnStmt;
+            }
+            case StmtKind::IMPORT: {
+                Token keyword = token();
+                return new (arena) ImportStmt(keyword, token(), &unit);
+            }
+        }
+        throw Corrupt();
+    }
+
+    Access access() {
+        uint8_t access = get<uint8_t>();
+        if (access > static_cast<uint8_t>(Access::GLOBAL)) throw Corrupt();
+        return static_cast<Access>(access);
+    }
+
+    int global(const Name& name) {
+        return unit.globals->slot(name.symbol);
+    }
+
+    // Every slot needs a declaration or an argument, so a frame can't have
+    // more of them than there are bytes left.
+    uint32_t frameSize() {
+        uint32_t size = get<uint32_t>();
+        if (size > size_t(end - p)) throw Corrupt();
+        return size;
+    }
+
+    // A slot of the frame being read, or one of its upvalues. A slot holds a
+    // cell only if the declaration in effect said so.
+    void slot(Access access, int64_t slot) {
+        if (slot < 0) throw Corrupt();
+        if (access != Access::UPVALUE) {
+            if (slot >= frame.locals || (access == Access::CELL) != frame.holdsCell(slot)) throw Corrupt();
+        } else if (frame.inlined) {
+            frame.upvalues = std::max<uint32_t>(frame.upvalues, slot + 1);
+        } else if (slot >= frame.upvalues) {
+            throw Corrupt();
+        }
+    }
+
+    // a declaration, which only goes in the frame
+    void define(Access access, int64_t slot) {
+        if (access == Access::UPVALUE || slot < 0 || slot >= frame.locals) throw Corrupt();
+        if (access == Access::CELL && slot >= int64_t(frame.cells.size())) frame.cells.resize(slot + 1);
+        if (slot < int64_t(frame.cells.size())) frame.cells[slot] = access == Access::CELL;
+    }
+
+    List<Statement*> statements() {
+        uint32_t n = count();
+        std::vector<Statement*> statements;
+        for (uint32_t i = 0; i < n; i++) statements.push_back(stmt());
+        return List<Statement*>(arena, statements);
+    }
+
+private:
+    // The frame the code being read runs in. An inlined body runs in that of
+    // its caller with the upvalues of the function it came from, which may not
+    // have been read yet, so only how many it uses is kept.
+    struct Frame {
+        uint32_t locals;
+        uint32_t upvalues;
+        bool inlined;
+        // by slot, grown as cells are declared
+        std::vector<bool> cells;
+
+        bool holdsCell(int64_t slot) const {
+            return slot < int64_t(cells.size()) && cells[slot];
+        }
+    };
+
+    CompilationUnit& unit;
+    Arena& arena;
+    std::string_view base;
+    Frame frame = {0, 0, false, {}};
+    std::vector<std::pair<Inline*, uint32_t>> inlines;
+    std::vector<Value> constants;
+    std::vector<LazyBody*> lazies;
+    // declarations by the offset of their name, and references to them
+    std::unordered_map<uint64_t, FunctionStmt*> functions;
+    std::vector<std::pair<FunctionStmt**, uint64_t>> fixups;
+};
+
+
+ScriptCache::ScriptCache(const char* script, std::string_view text, bool implicitBlock, int level, bool purity)
+    : sourceHash(hash(text)), sourceSize(text.size()), implicitBlock(implicitBlock), level(level), purity(purity) {
+    const char* dir = std::getenv("LOX_CACHE_DIR");
+    if (dir != nullptr && *dir != '\0') {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.loxc", static_cast<unsigned long long>(sourceHash));
+        path = std::string(dir) + "/" + name;
+    } else {
+        path = script;
+        size_t length = path.length();
+        path += length >= 4 && path.compare(length - 4, 4, ".lox") == 0 ? "c" : ".loxc";
+    }
+}
+
+// 64-bit multiply-xorshift over 8 bytes at a time
+uint64_t ScriptCache::hash(std::string_view text) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ text.size();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    for (; i < text.size(); i++) {
+        h = (h ^ static_cast<unsigned char>(text[i])) * 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+bool ScriptCache::load(CompilationUnit& unit) {
+    std::unique_ptr<Source> file(Source::load(path.c_str()));
+    if (file == nullptr) return false;
+
+    Reader reader(file->text(), unit);
+    try {
+        char magic[4];
+        for (char& c : magic) c = reader.get<char>();
+        if (std::memcmp(magic, MAGIC, 4) != 0) return false;
+        if (reader.get<uint32_t>() != VERSION) return false;
+        if (reader.get<uint64_t>() != sourceSize) return false;
+        if (reader.get<uint64_t>() != sourceHash) return false;
+        if (reader.get<uint8_t>() != implicitBlock) return false;
+        if (reader.get<uint8_t>() != level) return false;
+        if (reader.get<uint8_t>() != purity) return false;
+        if (reader.get<uint64_t>() != hash(std::string_view(reader.p, reader.end - reader.p))) return false;
+
+        reader.tables();
+        List<Statement*> statements = reader.statements();
+        if (reader.p != reader.end) throw Corrupt();
+        reader.resolveFunctions();
+        unit.statements = statements;
+        return true;
+    } catch (Corrupt&) {
+        unit.lazyBodies.clear();
+        unit.functions.clear();
+        return false;
+    }
+}
+
+// Written to a temporary file and renamed into place, so that concurrent runs
+// never see a partial cache.
+void ScriptCache::save(CompilationUnit& unit) {
+    Writer writer(unit);
+    std::string tables;
+    try {
+        writer.numberLazyBodies();
+        writer.statements(unit.statements);
+        tables = writer.tables();
+    } catch (Corrupt&) {
+        return;
+    }
+
+    Writer header(unit);
+    header.out.append(MAGIC, 4);
+    header.put<uint32_t>(VERSION);
+    header.put<uint64_t>(sourceSize);
+    header.put<uint64_t>(sourceHash);
+    header.put<uint8_t>(implicitBlock);
+    header.put<uint8_t>(level);
+    header.put<uint8_t>(purity);
+    header.put<uint64_t>(hash(tables + writer.out));
+
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return;
+        file << header.out << tables << writer.out;
+        if (!file) {
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str());
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) std::remove(temporary.c_str());
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "types.hpp"
+#include "unit.hpp"
+#include "source.hpp"
+#include "environment.hpp"
+
+// A script's parsed and resolved program, saved so that later runs of the same
+// source can skip the front end. The file is keyed by a hash of the source and
+// holds the AST with its resolved slots, captures and inlined calls, the
+// literals it uses, and the offsets of pre-parsed bodies. Tokens are stored as
+// offsets into the source, which is still loaded to check the hash against.
+// Indices of globals depend on the table the unit is loaded into, so they are
+// numbered again on load.
+//
+// The cache goes next to the script as `script.loxc`, or in $LOX_CACHE_DIR
+// named by the hash. A file is used only if its version, source size, source
+// hash, whether it was compiled as a script or a module, the optimization
+// level and whether purity was analyzed all match, and the rest of it matches
+// the checksum stored with them. Anything else, including a short file or one
+// whose indices don't fit the frames they refer to, is ignored and rewritten.
+class ScriptCache {
+public:
+    // bump whenever the node layout or the encoding changes
+    static const uint32_t VERSION = 14;
+
+    // scripts and modules compile differently, see Scanner::implicitBlock, and
+    // so does each optimization level, and --memoize-pure adds a pass
+    ScriptCache(const char* script, std::string_view text, bool implicitBlock, int level, bool purity);
+
+    // fills in the unit's statements, or returns false if there is no usable cache
+    bool load(CompilationUnit& unit);
+    void save(CompilationUnit& unit);
+
+    static uint64_t hash(std::string_view text);
+
+private:
+    class Corrupt : public std::runtime_error {
+    public:
+        Corrupt() : std::runtime_error("corrupt cache") {}
+    };
+
+    class Writer;
+    class Reader;
+
+    std::string path;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    bool implicitBlock;
+    uint8_t level;
+    bool purity;
+};
+
+#endif //CACHE_H_
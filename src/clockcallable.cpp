@@ -4,7 +4,7 @@
 
 int ClockCallable::arity() {return 0;};
 
-Value* ClockCallable::call(Interpreter* interpreter, std::vector<Value*> arguments) { 
+Value ClockCallable::call(Interpreter* interpreter, std::vector<Value> arguments) { 
 
     namespace sc = std::chrono;
     auto time = sc::system_clock::now();
@@ -13,7 +13,7 @@ Value* ClockCallable::call(Interpreter* interpreter, std::vector<Value*> argumen
     long now = millis.count() ;
     double now_s = now / 1000;
 
-    return new Value(now_s);
+    return Value(now_s);
 };
 
 std::string ClockCallable::toString() {return "<native fn>";};
@@ -9,7 +9,7 @@ class ClockCallable : public LoxCallable {
 public:
     int arity();
 
-    Value* call(Interpreter* interpreter, std::vector<Value*> arguments);
+    Value call(Interpreter* interpreter, std::vector<Value> arguments);
 
     std::string toString();
 
@@ -0,0 +1,55 @@
+#ifndef CONSTANTS_H_
+#define CONSTANTS_H_
+
+#include <deque>
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
+#include <mutex>
+#include "types.hpp"
+
+// Literal values, decoded once when they are parsed. Numbers, booleans and nil
+// fit in the Value itself; the text of string literals is kept here, once for
+// equal literals. Runtime values never change in place, so the interpreter
+// hands these out as they are. Modules are parsed on several threads, so
+// adding a string locks.
+class ConstantPool {
+public:
+    Value nil() { return Value(); }
+    Value boolean(bool value) { return Value(value); }
+
+    Value number(std::string_view lexeme) {
+        double value = 0;
+        std::from_chars(lexeme.data(), lexeme.data() + lexeme.length(), value);
+        return number(value);
+    }
+
+    Value number(double value) { return Value(value); }
+
+    Value string(std::string_view text) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = strings.find(text);
+        if (it != strings.end()) return it->second;
+        const std::string* copy = &texts.emplace_back(text);
+        // keyed on the constant's own copy of the text
+        return strings[*copy] = Value(copy);
+    }
+
+    // the constant a NUMBER, STRING, TRUE, FALSE or NIL token stands for
+    Value literal(const Token& token) {
+        switch (token.type) {
+            case TokenType::NUMBER: return number(token.lexeme());
+            case TokenType::STRING: return string(token.literal());
+            case TokenType::TRUE: return boolean(true);
+            case TokenType::FALSE: return boolean(false);
+            default: return nil();
+        }
+    }
+
+private:
+    std::mutex lock;
+    std::deque<std::string> texts;
+    std::unordered_map<std::string_view, Value> strings;
+};
+
+#endif //CONSTANTS_H_
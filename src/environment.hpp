@@ -1,84 +1,159 @@
 #ifndef ENVIRONMENT_HPP_
 #define ENVIRONMENT_HPP_
 #include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <vector>
 #include <string>
+#include <string_view>
 #include "types.hpp"
 #include "error.hpp"
+#include "memo.hpp"
 
-class Environment {
-private:
+// A variable a closure has captured, shared by the frame that declared it and
+// every closure that uses it.
+struct Cell {
+    Value value;
+};
 
-    std::unordered_map<std::string, Value*> values; 
+// A frame slot holds the value of a local, or its cell once it is captured.
+// Cleared, it is both undefined and no cell.
+union Slot {
+    Slot() : cell(nullptr) {}
 
+    Value value;
+    Cell* cell;
+};
 
+// The locals of one call, or of a unit's top-level code: a fixed row of slots
+// numbered by the Resolver and shared by every block in the body, along with
+// the upvalues of the closure running. Captured locals are kept in cells, so
+// nothing refers to a frame once its call returns and the slots come from the
+// FrameStack.
+class Environment {
 public:
-    Environment(Environment* enclosing) : enclosing(enclosing){}
-    
-    Environment(){
-        enclosing = nullptr;
-    }
+    Environment(Slot* slots, Cell* const* upvalues = nullptr) : slots(slots), upvalues(upvalues) {}
 
-    Environment* enclosing;
+    Slot* slots;
+    Cell* const* upvalues;
+};
 
-    Environment* ancestor( int distance){
-        Environment* environment = this; 
-        for(int i=0; i < distance; i++){ 
-            environment = environment->enclosing; 
-        }
+// The slots of the frames of the calls running, pushed on call and popped on
+// return. It grows in chunks that never move, so a frame's slots stay put
+// while calls nested in it push theirs.
+class FrameStack {
+public:
+    static constexpr uint32_t CHUNK_SIZE = 1 << 16;
 
-        return environment;
-    }
+    struct Mark {
+        size_t chunk;
+        uint32_t top;
+    };
 
-    void define(std::string name, Value* value) {
-       values[name] = value;
+    FrameStack() {
+        chunks.push_back({std::make_unique<Slot[]>(CHUNK_SIZE), CHUNK_SIZE});
+    }
 
+    // where to pop back to
+    Mark mark() const {
+        return {chunk, top};
     }
 
+    void release(Mark mark) {
+        chunk = mark.chunk;
+        top = mark.top;
+    }
 
-    Value* get(Token name){
-        auto it = values.find(name.lexeme);
+    // `size` cleared slots
+    Slot* push(uint32_t size) {
+        if (size > chunks[chunk].size - top) {
+            chunk++;
+            top = 0;
+            uint32_t needed = std::max(size, CHUNK_SIZE);
+            if (chunk == chunks.size()) chunks.push_back({std::make_unique<Slot[]>(needed), needed});
+            else if (chunks[chunk].size < size) chunks[chunk] = {std::make_unique<Slot[]>(needed), needed};
+        }
+        Slot* frame = chunks[chunk].slots.get() + top;
+        top += size;
+        std::fill(frame, frame + size, Slot());
+        return frame;
+    }
 
-        if (it != values.end()) 
-           return it->second;
+private:
+    struct Chunk {
+        std::unique_ptr<Slot[]> slots;
+        uint32_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t chunk = 0;
+    uint32_t top = 0;
+};
 
-        if (enclosing != nullptr) 
-            return enclosing->get(name);
 
-        throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+// The globals of one script or module, in a dense table. The Resolver gives
+// each global name an index in the table of the unit it compiles, and the
+// interpreter reads and writes that index directly. A name that is referenced
+// but not defined yet is undefined, which raises the undefined variable error.
+// Names not found fall back to the builtins, once.
+// With --memoize-pure, giving a name that held a function another value stops
+// memoization.
+class Globals {
+public:
+    explicit Globals(Globals* builtins = nullptr) : builtins(builtins) {}
+
+    // the index of `name`, added undefined if it hasn't got one yet
+    uint32_t slot(Symbol name) {
+        auto it = slots.find(name);
+        if (it != slots.end()) return it->second;
+        slots[name] = values.size();
+        values.push_back(Value::undefined());
+        return values.size() - 1;
     }
 
-    Value* getAt(int distance, Token name){
-        auto temp = ancestor(distance)->values; 
-        if (temp.find(name.lexeme) != temp.end())
-            return temp[name.lexeme];
+    void define(uint32_t slot, Value value) {
+        if (Memo::enabled) Memo::rebind(values[slot], value);
+        values[slot] = value;
+    }
 
-        throw RuntimeError(name, "Undefined variable '" + name.lexeme +"'.");
-        return new Value(); 
+    Value get(uint32_t slot, const Name& name) {
+        Value value = values[slot];
+        if (value.defined()) return value;
+        return values[slot] = builtin(name);
     }
 
-    void view(){
-        for (auto it = values.begin(); it != values.end(); it ++)
-            std::cout << it->first << " " << it->second->view() << " \n";
+    void assign(uint32_t slot, const Name& name, Value value) {
+        Value previous = values[slot].defined() ? values[slot] : builtin(name);
+        if (Memo::enabled) Memo::rebind(previous, value);
+        values[slot] = value;
     }
 
-    void assign(Token name, Value* value){
-        auto it = values.find(name.lexeme);
-        if (it != values.end()){
-            values[name.lexeme] = value;
-            return;
+    // what `import` does: defines here those of `names` the module has defined
+    void import(Globals& module, const std::vector<Symbol>& names) {
+        for (Symbol name : names) {
+            auto it = module.slots.find(name);
+            if (it != module.slots.end() && module.values[it->second].defined()) {
+                uint32_t index = slot(name);
+                if (Memo::enabled) Memo::rebind(values[index], module.values[it->second]);
+                values[index] = module.values[it->second];
+            }
         }
-
-        if (enclosing != nullptr) 
-            return enclosing->assign(name, value);
-
-        throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
     }
 
-    void assignAt(int distance, Token name, Value* value) {
-        ancestor(distance)->values[name.lexeme] = value;
+private:
+    Value builtin(const Name& name) {
+        if (builtins != nullptr) {
+            auto it = builtins->slots.find(name.symbol);
+            if (it != builtins->slots.end() && builtins->values[it->second].defined())
+                return builtins->values[it->second];
+        }
+        throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme()) + "'.");
     }
 
+    Globals* builtins;
+    std::unordered_map<Symbol, uint32_t> slots;
+    std::vector<Value> values;
 };
 
 
-#endif //ENVIRONMENT_HPP_
\ No newline at end of file
+#endif //ENVIRONMENT_HPP_
@@ -1,6 +1,8 @@
 #ifndef ERROR_H_
 #define ERROR_H_
 
+#include <mutex>
+
 #include "types.hpp"
 
 class RuntimeError: public std::runtime_error {
@@ -12,10 +14,17 @@ public:
     ~RuntimeError(){}
 };
 
+class LoxFunction;
+
 class Return: public std::runtime_error {
 public:
-    Return(Value* value) : value(value) , std::runtime_error("") {};
-    Value*  value;
+    Return(Value value) : value(value) , std::runtime_error("") {};
+    // a tail call, for the LoxFunction::call that catches it to make
+    Return(LoxFunction* callee, std::vector<Value> arguments)
+        : std::runtime_error(""), value(Value::undefined()), callee(callee), arguments(std::move(arguments)) {};
+    Value value;
+    LoxFunction* callee = nullptr;
+    std::vector<Value> arguments;
 };
 
 class ParseError : public std::runtime_error {
@@ -25,9 +34,12 @@ public:
 };
 
 
-bool hadError = false; 
+// Per thread, so that modules compiled in parallel each see only their own errors.
+thread_local bool hadError = false; 
 
 void report(int line, const std::string& where, const std::string& message) {
+    static std::mutex output;
+    std::lock_guard<std::mutex> guard(output);
     std::cerr << "[line " << line << "] Error" << where << ": " << message << std::endl;
     hadError = true;
 }
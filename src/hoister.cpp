@@ -0,0 +1,269 @@
+#include "hoister.hpp"
+
+
+void Hoister::hoist(const List<Statement*>& statements, uint32_t& locals){
+    this->locals = &locals;
+    for (Statement*& statement : statements) statement = stmt(statement);
+}
+
+// Inner loops first, so what they moved out can move further.
+Statement* Hoister::stmt(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::BLOCK:
+            for (Statement*& statement : static_cast<BlockStmt*>(stmt)->statements) statement = this->stmt(statement);
+            return stmt;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            ifStmt->thenBranch = this->stmt(ifStmt->thenBranch);
+            if (ifStmt->elseBranch != nullptr) ifStmt->elseBranch = this->stmt(ifStmt->elseBranch);
+            return ifStmt;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            whileStmt->body = this->stmt(whileStmt->body);
+            return loop(whileStmt);
+        }
+        // a body is hoisted from when it is compiled
+        case StmtKind::FUNCTION:
+        case StmtKind::PRINT:
+        case StmtKind::EXPR:
+        case StmtKind::VAR:
+        case StmtKind::RETURN:
+        case StmtKind::IMPORT:
+            return stmt;
+    }
+    return stmt;
+}
+
+Statement* Hoister::loop(WhileStmt* loop){
+    written.assign(*locals, false);
+    writes(loop->condition);
+    writes(loop->body);
+
+    preheader.clear();
+    loop->condition = moveFrom(loop->condition);
+    moveFrom(loop->body);
+    if (preheader.empty()) return loop;
+
+    preheader.push_back(loop);
+    return new (arena) BlockStmt(List<Statement*>(arena, preheader));
+}
+
+void Hoister::writes(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT:
+            writes(static_cast<PrintStmt*>(stmt)->expression);
+            break;
+        case StmtKind::EXPR:
+            writes(static_cast<ExprStmt*>(stmt)->expression);
+            break;
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            if (var->initializer != nullptr) writes(var->initializer);
+            write(var->access, var->slot);
+            break;
+        }
+        case StmtKind::BLOCK:
+            for (Statement* statement : static_cast<BlockStmt*>(stmt)->statements) writes(statement);
+            break;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            writes(ifStmt->condition);
+            writes(ifStmt->thenBranch);
+            if (ifStmt->elseBranch != nullptr) writes(ifStmt->elseBranch);
+            break;
+        }
+        case StmtKind::WHILE:
+            writes(static_cast<WhileStmt*>(stmt)->condition);
+            writes(static_cast<WhileStmt*>(stmt)->body);
+            break;
+        case StmtKind::FUNCTION: {
+            FunctionStmt* function = static_cast<FunctionStmt*>(stmt);
+            write(function->access, function->slot);
+            break;
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            if (returnStmt->value != nullptr) writes(returnStmt->value);
+            break;
+        }
+        case StmtKind::IMPORT:
+            break;
+    }
+}
+
+void Hoister::writes(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY:
+            writes(static_cast<Binary*>(expr)->left);
+            writes(static_cast<Binary*>(expr)->right);
+            break;
+        case ExprKind::GROUPING:
+            writes(static_cast<Grouping*>(expr)->expression);
+            break;
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            writes(call->callee);
+            for (Expr* argument : call->arguments) writes(argument);
+            break;
+        }
+        case ExprKind::UNARY:
+            writes(static_cast<Unary*>(expr)->right);
+            break;
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            writes(assign->value);
+            write(assign->access, assign->slot);
+            break;
+        }
+        case ExprKind::LOGICAL:
+            writes(static_cast<Logical*>(expr)->left);
+            writes(static_cast<Logical*>(expr)->right);
+            break;
+        case ExprKind::INLINE: {
+            // the parameters and locals of the body are slots of this frame
+            Inline* inlined = static_cast<Inline*>(expr);
+            writes(inlined->call);
+            writes(inlined->body);
+            for (uint32_t i = 0; i < inlined->function->locals; i++) write(Access::LOCAL, inlined->base + i);
+            break;
+        }
+        case ExprKind::LITERAL:
+        case ExprKind::VARIABLE:
+            break;
+    }
+}
+
+void Hoister::write(Access access, int slot){
+    if (access == Access::LOCAL) written[slot] = true;
+}
+
+void Hoister::moveFrom(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT: {
+            PrintStmt* print = static_cast<PrintStmt*>(stmt);
+            print->expression = moveFrom(print->expression);
+            break;
+        }
+        case StmtKind::EXPR: {
+            ExprStmt* exprStmt = static_cast<ExprStmt*>(stmt);
+            exprStmt->expression = moveFrom(exprStmt->expression);
+            break;
+        }
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            if (var->initializer != nullptr) var->initializer = moveFrom(var->initializer);
+            break;
+        }
+        case StmtKind::BLOCK:
+            for (Statement* statement : static_cast<BlockStmt*>(stmt)->statements) moveFrom(statement);
+            break;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            ifStmt->condition = moveFrom(ifStmt->condition);
+            moveFrom(ifStmt->thenBranch);
+            if (ifStmt->elseBranch != nullptr) moveFrom(ifStmt->elseBranch);
+            break;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            whileStmt->condition = moveFrom(whileStmt->condition);
+            moveFrom(whileStmt->body);
+            break;
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            if (returnStmt->value != nullptr) returnStmt->value = moveFrom(returnStmt->value);
+            break;
+        }
+        // runs in a frame of its own
+        case StmtKind::FUNCTION:
+        case StmtKind::IMPORT:
+            break;
+    }
+}
+
+// The largest invariant operations in `expr`, replaced by reads of the slots
+// they are computed into.
+Expr* Hoister::moveFrom(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY: {
+            Binary* binary = static_cast<Binary*>(expr);
+            // one with only literals was folded by the Optimizer
+            if (invariant(binary)) {
+                VarStmt* var = new (arena) VarStmt(Name::temporary(binary->oper.line), binary);
+                var->access = Access::LOCAL;
+                var->slot = (*locals)++;
+                preheader.push_back(var);
+
+                Variable* variable = new (arena) Variable(var->name);
+                variable->access = Access::LOCAL;
+                variable->slot = var->slot;
+                return variable;
+            }
+            binary->left = moveFrom(binary->left);
+            binary->right = moveFrom(binary->right);
+            return binary;
+        }
+        case ExprKind::GROUPING: {
+            Grouping* grouping = static_cast<Grouping*>(expr);
+            grouping->expression = moveFrom(grouping->expression);
+            return grouping;
+        }
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            call->callee = moveFrom(call->callee);
+            for (Expr*& argument : call->arguments) argument = moveFrom(argument);
+            return call;
+        }
+        case ExprKind::UNARY: {
+            Unary* unary = static_cast<Unary*>(expr);
+            unary->right = moveFrom(unary->right);
+            return unary;
+        }
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            assign->value = moveFrom(assign->value);
+            return assign;
+        }
+        case ExprKind::LOGICAL: {
+            Logical* logical = static_cast<Logical*>(expr);
+            logical->left = moveFrom(logical->left);
+            logical->right = moveFrom(logical->right);
+            return logical;
+        }
+        case ExprKind::INLINE: {
+            Inline* inlined = static_cast<Inline*>(expr);
+            inlined->call->callee = moveFrom(inlined->call->callee);
+            for (Expr*& argument : inlined->call->arguments) argument = moveFrom(argument);
+            inlined->body = moveFrom(inlined->body);
+            return inlined;
+        }
+        case ExprKind::LITERAL:
+        case ExprKind::VARIABLE:
+            return expr;
+    }
+    return expr;
+}
+
+// Interpreter::evaluateNumber runs a numeric operation without checking its
+// operands, so it can't fail. What it gives for operands that aren't numbers
+// is never used: the loop only reads it where they were proved to be.
+bool Hoister::invariant(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY: {
+            Binary* binary = static_cast<Binary*>(expr);
+            return binary->numeric && invariant(binary->left) && invariant(binary->right);
+        }
+        case ExprKind::GROUPING:
+            return invariant(static_cast<Grouping*>(expr)->expression);
+        case ExprKind::LITERAL:
+            return true;
+        case ExprKind::VARIABLE: {
+            Variable* variable = static_cast<Variable*>(expr);
+            return variable->access == Access::LOCAL && !written[variable->slot];
+        }
+        default:
+            return false;
+    }
+}
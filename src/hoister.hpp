@@ -0,0 +1,51 @@
+#ifndef HOISTER_H_
+#define HOISTER_H_
+
+#include <vector>
+
+#include "types.hpp"
+#include "unit.hpp"
+
+// Moves arithmetic whose operands don't change in a loop out of it. Such an
+// expression is computed once into a new slot before the loop, and the loop
+// reads the slot instead:
+//
+//     while (i < n * 2) ...   becomes   { var t = n * 2; while (i < t) ... }
+//
+// Only operations TypeInference marked as numeric are moved, with literals
+// and locals the loop never writes as their operands. Those can't fail or
+// have side effects, so running one before the loop, even if the loop never
+// gets to it, changes nothing. Calls, assignments, captured locals, upvalues
+// and globals are never moved, as anything the loop calls could change them.
+//
+// Runs after TypeInference, on code already inlined into.
+class Hoister {
+public:
+    explicit Hoister(CompilationUnit& unit) : arena(unit.arena) {}
+
+    // `locals` is the frame size of the code, which grows by a slot for each
+    // expression moved
+    void hoist(const List<Statement*>& statements, uint32_t& locals);
+
+private:
+    Arena& arena;
+    uint32_t* locals = nullptr;
+    // the slots the loop being looked at writes
+    std::vector<bool> written;
+    // what goes before it
+    std::vector<Statement*> preheader;
+
+    // the statement to run instead
+    Statement* stmt(Statement* stmt);
+    Statement* loop(WhileStmt* loop);
+
+    void writes(Statement* stmt);
+    void writes(Expr* expr);
+    void write(Access access, int slot);
+
+    void moveFrom(Statement* stmt);
+    Expr* moveFrom(Expr* expr);
+    bool invariant(Expr* expr);
+};
+
+#endif //HOISTER_H_
@@ -0,0 +1,211 @@
+#include "inference.hpp"
+
+
+void TypeInference::infer(const List<Statement*>& statements, uint32_t locals){
+    // a function nested in the code being inferred starts afresh
+    State enclosing = std::move(state);
+    bool enclosingAnnotate = annotate;
+    state = State{std::vector<bool>(locals, false), true};
+    annotate = true;
+
+    for (Statement* statement : statements) stmt(statement);
+
+    state = std::move(enclosing);
+    annotate = enclosingAnnotate;
+}
+
+void TypeInference::stmt(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT:
+            expr(static_cast<PrintStmt*>(stmt)->expression);
+            break;
+        case StmtKind::EXPR:
+            expr(static_cast<ExprStmt*>(stmt)->expression);
+            break;
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            bool number = var->initializer != nullptr && expr(var->initializer);
+            set(var->access, var->slot, number);
+            break;
+        }
+        case StmtKind::BLOCK:
+            for (Statement* statement : static_cast<BlockStmt*>(stmt)->statements) this->stmt(statement);
+            break;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            expr(ifStmt->condition);
+            State before = state;
+            this->stmt(ifStmt->thenBranch);
+            State thenState = std::move(state);
+            state = std::move(before);
+            if (ifStmt->elseBranch != nullptr) this->stmt(ifStmt->elseBranch);
+            state = join(thenState, state);
+            break;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            bool outer = annotate;
+            annotate = false;
+            State entry = state;
+            State head;
+            while (true) {
+                head = state;
+                expr(whileStmt->condition);
+                this->stmt(whileStmt->body);
+                State next = join(entry, state);
+                if (next == head) break;
+                state = std::move(next);
+            }
+            annotate = outer;
+
+            state = std::move(head);
+            expr(whileStmt->condition);
+            State exit = state;
+            this->stmt(whileStmt->body);
+            state = std::move(exit);
+            break;
+        }
+        case StmtKind::FUNCTION: {
+            FunctionStmt* function = static_cast<FunctionStmt*>(stmt);
+            set(function->access, function->slot, false);
+            // a pre-parsed body is inferred when it is compiled
+            if (function->lazy == nullptr) infer(function->body, function->locals);
+            break;
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            if (returnStmt->value != nullptr) expr(returnStmt->value);
+            state.live = false;
+            break;
+        }
+        case StmtKind::IMPORT:
+            break;
+    }
+}
+
+bool TypeInference::expr(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY:
+            return binary(*static_cast<Binary*>(expr));
+        case ExprKind::GROUPING:
+            return this->expr(static_cast<Grouping*>(expr)->expression);
+        case ExprKind::LITERAL:
+            return static_cast<Literal*>(expr)->value.type() == ValueType::NUMBER;
+        case ExprKind::CALL: {
+            // a call can't reach the frame's own slots
+            Call* call = static_cast<Call*>(expr);
+            this->expr(call->callee);
+            for (Expr* argument : call->arguments) this->expr(argument);
+            return false;
+        }
+        case ExprKind::UNARY: {
+            Unary* unary = static_cast<Unary*>(expr);
+            this->expr(unary->right);
+            return unary->oper.type == TokenType::MINUS;
+        }
+        case ExprKind::VARIABLE: {
+            Variable* variable = static_cast<Variable*>(expr);
+            return variable->access == Access::LOCAL && state.numbers[variable->slot];
+        }
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            bool number = this->expr(assign->value);
+            set(assign->access, assign->slot, number);
+            return number;
+        }
+        case ExprKind::LOGICAL: {
+            Logical* logical = static_cast<Logical*>(expr);
+            bool left = this->expr(logical->left);
+            State shortCircuit = state;
+            bool right = this->expr(logical->right);
+            state = join(shortCircuit, state);
+            return left && right;
+        }
+        case ExprKind::INLINE: {
+            // the parameters are slots of this frame, bound to the arguments
+            Inline* inlined = static_cast<Inline*>(expr);
+            this->expr(inlined->call->callee);
+            for (size_t i = 0; i < inlined->call->arguments.size(); i++)
+                set(Access::LOCAL, inlined->base + i, this->expr(inlined->call->arguments[i]));
+            return this->expr(inlined->body);
+        }
+    }
+    return false;
+}
+
+// What Interpreter::visitBinary accepts: arithmetic and comparisons only on
+// two numbers, `+` on two numbers or two strings, and equality on two of the
+// same type.
+bool TypeInference::binary(Binary& binary){
+    bool left = expr(binary.left);
+    bool right = expr(binary.right);
+    if (annotate) binary.numeric = left && right;
+
+    // the left operand was read before the right one ran, so it is only
+    // known to still be what was checked if the right one assigns nothing
+    bool leftStill = !assigns(binary.right);
+    switch (binary.oper.type) {
+        case TokenType::MINUS:
+        case TokenType::SLASH:
+        case TokenType::STAR:
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL:
+            refine(binary.right);
+            if (leftStill) refine(binary.left);
+            return binary.oper.type == TokenType::MINUS || binary.oper.type == TokenType::SLASH
+                || binary.oper.type == TokenType::STAR;
+        case TokenType::PLUS:
+            if (left) refine(binary.right);
+            if (right && leftStill) refine(binary.left);
+            return left || right;
+        default:
+            return false;
+    }
+}
+
+void TypeInference::refine(Expr* expr){
+    if (expr->kind == ExprKind::VARIABLE) {
+        Variable* variable = static_cast<Variable*>(expr);
+        set(variable->access, variable->slot, true);
+    } else if (expr->kind == ExprKind::ASSIGN) {
+        Assign* assign = static_cast<Assign*>(expr);
+        set(assign->access, assign->slot, true);
+    }
+}
+
+void TypeInference::set(Access access, int slot, bool number){
+    if (access == Access::GLOBAL || access == Access::UPVALUE) return;
+    // a captured slot holds a cell, which closures can change
+    state.numbers[slot] = access == Access::LOCAL && number;
+}
+
+TypeInference::State TypeInference::join(const State& a, const State& b){
+    if (!a.live) return b;
+    if (!b.live) return a;
+    State joined = a;
+    for (size_t i = 0; i < joined.numbers.size(); i++) joined.numbers[i] = a.numbers[i] && b.numbers[i];
+    return joined;
+}
+
+bool TypeInference::assigns(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::ASSIGN: return true;
+        case ExprKind::BINARY:
+            return assigns(static_cast<Binary*>(expr)->left) || assigns(static_cast<Binary*>(expr)->right);
+        case ExprKind::GROUPING: return assigns(static_cast<Grouping*>(expr)->expression);
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            if (assigns(call->callee)) return true;
+            for (Expr* argument : call->arguments) if (assigns(argument)) return true;
+            return false;
+        }
+        case ExprKind::UNARY: return assigns(static_cast<Unary*>(expr)->right);
+        case ExprKind::LOGICAL:
+            return assigns(static_cast<Logical*>(expr)->left) || assigns(static_cast<Logical*>(expr)->right);
+        // the body only assigns its own slots
+        case ExprKind::INLINE: return assigns(static_cast<Inline*>(expr)->call);
+        default: return false;
+    }
+}
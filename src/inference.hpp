@@ -0,0 +1,51 @@
+#ifndef INFERENCE_H_
+#define INFERENCE_H_
+
+#include <vector>
+
+#include "types.hpp"
+
+// Works out which binary operations always see two numbers, so that the
+// interpreter can skip the type checks on them. It follows the locals held in
+// the frame slots through the code. A slot holds a number after it has been
+// given a number literal or the result of arithmetic, or after it was an
+// operand of something that only works on numbers: once `n < 2` has not
+// failed, `n` is a number. Captured locals, upvalues and globals can change
+// behind the code's back, so nothing is assumed about them.
+//
+// A loop is run to a fixed point before its nodes are marked, so what is
+// marked holds on every iteration.
+class TypeInference {
+public:
+    // the top-level code of a unit or a function body, and its frame size
+    void infer(const List<Statement*>& statements, uint32_t locals);
+
+private:
+    // which slots are known to hold numbers; nothing is known about code
+    // that can't be reached
+    struct State {
+        std::vector<bool> numbers;
+        bool live = true;
+
+        bool operator==(const State& other) const {
+            return live == other.live && numbers == other.numbers;
+        }
+    };
+
+    State state;
+    // false while a loop is run to its fixed point
+    bool annotate = true;
+
+    void stmt(Statement* stmt);
+    // whether it evaluates to a number
+    bool expr(Expr* expr);
+    bool binary(Binary& binary);
+    // `expr` was an operand of an operation that only works on numbers
+    void refine(Expr* expr);
+    void set(Access access, int slot, bool number);
+
+    static State join(const State& a, const State& b);
+    static bool assigns(Expr* expr);
+};
+
+#endif //INFERENCE_H_
@@ -0,0 +1,220 @@
+#include "inliner.hpp"
+#include "loxfunction.hpp"
+
+
+void Inliner::inlineCalls(const List<Statement*>& statements, uint32_t& locals){
+    this->locals = &locals;
+    for (Statement* statement : statements) stmt(statement);
+}
+
+void Inliner::stmt(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT: {
+            PrintStmt* print = static_cast<PrintStmt*>(stmt);
+            print->expression = expr(print->expression);
+            break;
+        }
+        case StmtKind::EXPR: {
+            ExprStmt* exprStmt = static_cast<ExprStmt*>(stmt);
+            exprStmt->expression = expr(exprStmt->expression);
+            break;
+        }
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            if (var->initializer != nullptr) var->initializer = expr(var->initializer);
+            break;
+        }
+        case StmtKind::BLOCK:
+            for (Statement* statement : static_cast<BlockStmt*>(stmt)->statements) this->stmt(statement);
+            break;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            ifStmt->condition = expr(ifStmt->condition);
+            this->stmt(ifStmt->thenBranch);
+            if (ifStmt->elseBranch != nullptr) this->stmt(ifStmt->elseBranch);
+            break;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            whileStmt->condition = expr(whileStmt->condition);
+            this->stmt(whileStmt->body);
+            break;
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            if (returnStmt->value != nullptr) returnStmt->value = expr(returnStmt->value);
+            // an inlined call has no frame to replace
+            if (returnStmt->tailCall && returnStmt->value->kind != ExprKind::CALL) returnStmt->tailCall = false;
+            break;
+        }
+        // a body is inlined into when it is compiled
+        case StmtKind::FUNCTION:
+        case StmtKind::IMPORT:
+            break;
+    }
+}
+
+Expr* Inliner::expr(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY: {
+            Binary* binary = static_cast<Binary*>(expr);
+            binary->left = this->expr(binary->left);
+            binary->right = this->expr(binary->right);
+            return binary;
+        }
+        case ExprKind::GROUPING: {
+            Grouping* grouping = static_cast<Grouping*>(expr);
+            grouping->expression = this->expr(grouping->expression);
+            return grouping;
+        }
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            call->callee = this->expr(call->callee);
+            for (Expr*& argument : call->arguments) argument = this->expr(argument);
+            return inlineCall(call);
+        }
+        case ExprKind::UNARY: {
+            Unary* unary = static_cast<Unary*>(expr);
+            unary->right = this->expr(unary->right);
+            return unary;
+        }
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            assign->value = this->expr(assign->value);
+            return assign;
+        }
+        case ExprKind::LOGICAL: {
+            Logical* logical = static_cast<Logical*>(expr);
+            logical->left = this->expr(logical->left);
+            logical->right = this->expr(logical->right);
+            return logical;
+        }
+        case ExprKind::LITERAL:
+        case ExprKind::VARIABLE:
+        case ExprKind::INLINE:
+            return expr;
+    }
+    return expr;
+}
+
+Expr* Inliner::inlineCall(Call* call){
+    FunctionStmt* function = call->target;
+    if (function == nullptr || function->unit != &unit || call->arguments.size() != function->params.size()
+        || LoxFunction::compiling(*function))
+        return call;
+
+    if (function->lazy != nullptr) {
+        if (!function->lazy->expression) return call;
+        // a repeated parameter is the one error such a body can have
+        for (size_t i = 0; i < function->params.size(); i++)
+            for (size_t j = 0; j < i; j++)
+                if (function->params[i].symbol == function->params[j].symbol) return call;
+        LoxFunction::compile(*function);
+    }
+
+    Expr* body = this->body(*function);
+    if (body == nullptr) return call;
+    uint32_t base = *locals;
+    *locals += function->locals;
+    return new (arena) Inline(call, function, base, copy(body, base));
+}
+
+Expr* Inliner::body(FunctionStmt& function){
+    if (function.body.size() != 1 || function.body[0]->kind != StmtKind::RETURN) return nullptr;
+    Expr* value = static_cast<ReturnStmt*>(function.body[0])->value;
+    if (value == nullptr) return nullptr;
+    for (bool cell : function.cellParams) if (cell) return nullptr;
+    if (size(value, function) > MAX_NODES) return nullptr;
+    return value;
+}
+
+Expr* Inliner::copy(Expr* expr, uint32_t base){
+    switch (expr->kind) {
+        case ExprKind::BINARY: {
+            Binary* binary = new (arena) Binary(*static_cast<Binary*>(expr));
+            binary->left = copy(binary->left, base);
+            binary->right = copy(binary->right, base);
+            return binary;
+        }
+        case ExprKind::GROUPING: {
+            Grouping* grouping = new (arena) Grouping(*static_cast<Grouping*>(expr));
+            grouping->expression = copy(grouping->expression, base);
+            return grouping;
+        }
+        case ExprKind::LITERAL:
+            return expr;
+        case ExprKind::CALL: {
+            Call* call = new (arena) Call(*static_cast<Call*>(expr));
+            call->callee = copy(call->callee, base);
+            std::vector<Expr*> arguments;
+            for (Expr* argument : call->arguments) arguments.push_back(copy(argument, base));
+            call->arguments = List<Expr*>(arena, arguments);
+            return call;
+        }
+        case ExprKind::UNARY: {
+            Unary* unary = new (arena) Unary(*static_cast<Unary*>(expr));
+            unary->right = copy(unary->right, base);
+            return unary;
+        }
+        case ExprKind::VARIABLE: {
+            Variable* variable = new (arena) Variable(*static_cast<Variable*>(expr));
+            if (variable->access == Access::LOCAL) variable->slot += base;
+            return variable;
+        }
+        case ExprKind::ASSIGN: {
+            Assign* assign = new (arena) Assign(*static_cast<Assign*>(expr));
+            assign->value = copy(assign->value, base);
+            if (assign->access == Access::LOCAL) assign->slot += base;
+            return assign;
+        }
+        case ExprKind::LOGICAL: {
+            Logical* logical = new (arena) Logical(*static_cast<Logical*>(expr));
+            logical->left = copy(logical->left, base);
+            logical->right = copy(logical->right, base);
+            return logical;
+        }
+        case ExprKind::INLINE: {
+            Inline* inlined = new (arena) Inline(*static_cast<Inline*>(expr));
+            inlined->call = static_cast<Call*>(copy(inlined->call, base));
+            inlined->base += base;
+            inlined->body = copy(inlined->body, base);
+            inlined->seen = nullptr;
+            return inlined;
+        }
+    }
+    return expr;
+}
+
+int Inliner::size(Expr* expr, FunctionStmt& function){
+    switch (expr->kind) {
+        case ExprKind::BINARY:
+            return 1 + size(static_cast<Binary*>(expr)->left, function) + size(static_cast<Binary*>(expr)->right, function);
+        case ExprKind::GROUPING:
+            return 1 + size(static_cast<Grouping*>(expr)->expression, function);
+        case ExprKind::LITERAL:
+            return 1;
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            if (call->target == &function) return MAX_NODES + 1;
+            int nodes = 1 + size(call->callee, function);
+            for (Expr* argument : call->arguments) nodes += size(argument, function);
+            return nodes;
+        }
+        case ExprKind::UNARY:
+            return 1 + size(static_cast<Unary*>(expr)->right, function);
+        case ExprKind::VARIABLE:
+            return static_cast<Variable*>(expr)->access == Access::CELL ? MAX_NODES + 1 : 1;
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            if (assign->access == Access::CELL) return MAX_NODES + 1;
+            return 1 + size(assign->value, function);
+        }
+        case ExprKind::LOGICAL:
+            return 1 + size(static_cast<Logical*>(expr)->left, function) + size(static_cast<Logical*>(expr)->right, function);
+        case ExprKind::INLINE: {
+            Inline* inlined = static_cast<Inline*>(expr);
+            return 1 + size(inlined->call, function) + size(inlined->body, function);
+        }
+    }
+    return MAX_NODES + 1;
+}
@@ -0,0 +1,45 @@
+#ifndef INLINER_H_
+#define INLINER_H_
+
+#include <vector>
+
+#include "types.hpp"
+#include "unit.hpp"
+
+// Replaces calls to small functions with a copy of their bodies, saving the
+// argument vector, the frame and the Return exception of a call. A function
+// is small if its body is a single `return` of an expression of at most
+// MAX_NODES nodes that doesn't call the function itself. Only calls the
+// Resolver could tie to a `fun` of the same unit are inlined, and each
+// inlined call still checks the callee is that function when it runs.
+//
+// A small function that has only been pre-parsed is compiled here, which is
+// safe because a body that is just a `return` has no resolution errors to
+// report early. Bodies compiled later are inlined into as they are compiled.
+class Inliner {
+public:
+    static constexpr int MAX_NODES = 24;
+
+    explicit Inliner(CompilationUnit& unit) : unit(unit), arena(unit.arena) {}
+
+    // `locals` is the frame size of the code, which grows by the slots the
+    // inlined calls bind their parameters to
+    void inlineCalls(const List<Statement*>& statements, uint32_t& locals);
+
+private:
+    CompilationUnit& unit;
+    Arena& arena;
+    uint32_t* locals = nullptr;
+
+    void stmt(Statement* stmt);
+    Expr* expr(Expr* expr);
+    Expr* inlineCall(Call* call);
+    // the expression `function` returns, if it can be inlined
+    Expr* body(FunctionStmt& function);
+    // `expr` for a frame whose slots start at `base`
+    Expr* copy(Expr* expr, uint32_t base);
+    // how many nodes, or more than MAX_NODES if it can't be copied
+    static int size(Expr* expr, FunctionStmt& function);
+};
+
+#endif //INLINER_H_
@@ -2,58 +2,96 @@
 #include <chrono>
 
 #include "interpreter.hpp"
+#include "module.hpp"
 
 
 
 
-Value* Interpreter::evaluate(Expr* expr){
+Value Interpreter::evaluate(Expr* expr){
+    switch (expr->kind){
+        case ExprKind::BINARY: return visitBinary(*static_cast<Binary*>(expr));
+        case ExprKind::GROUPING: return visitGrouping(*static_cast<Grouping*>(expr));
+        case ExprKind::LITERAL: return visitLiteral(*static_cast<Literal*>(expr));
+        case ExprKind::CALL: return visitCallExpr(*static_cast<Call*>(expr));
+        case ExprKind::UNARY: return visitUnary(*static_cast<Unary*>(expr));
+        case ExprKind::VARIABLE: return visitVariable(*static_cast<Variable*>(expr));
+        case ExprKind::ASSIGN: return visitAssign(*static_cast<Assign*>(expr));
+        case ExprKind::LOGICAL: return visitLogicalExpr(*static_cast<Logical*>(expr));
+        case ExprKind::INLINE: return visitInline(*static_cast<Inline*>(expr));
+    }
     return expr->accept(*this);
 }
 
-bool Interpreter::isTruthy(Value* value){
-    if(value->type == ValueType::NIL)
+bool Interpreter::isTruthy(Value value){
+    if(value.type() == ValueType::NIL)
         return false;
-    if (value->type == ValueType::BOOLEAN){
-        return value->bool_;
+    if (value.type() == ValueType::BOOLEAN){
+        return value.boolean();
     }
 
     return  true;
 }
 
-bool Interpreter::isEqual(Value* a, Value* b){
-    if (a->type == ValueType::NIL && b->type == ValueType::NIL)
-        return true;
-    if (a->type == ValueType::NIL) 
+bool Interpreter::isEqual(Value a, Value b){
+    if (a.type() != b.type())
         return false;
-    
-    return  a->bool_ == b->bool_ ;
+
+    switch (a.type()){
+        case ValueType::NIL: return true;
+        case ValueType::NUMBER: return a.number() == b.number();
+        case ValueType::STRING: return a.str() == b.str();
+        case ValueType::BOOLEAN: return a.boolean() == b.boolean();
+        case ValueType::CALLABLE: return a.callable() == b.callable();
+    }
+    return false;
 }
 
 void Interpreter::execute(Statement* stmt){
-    stmt->accept(*this);
+    switch (stmt->kind){
+        case StmtKind::PRINT: return visitPrintStmt(*static_cast<PrintStmt*>(stmt));
+        case StmtKind::EXPR: return visitExprStmt(*static_cast<ExprStmt*>(stmt));
+        case StmtKind::VAR: return visitVarStmt(*static_cast<VarStmt*>(stmt));
+        case StmtKind::BLOCK: return visitBlockStmt(*static_cast<BlockStmt*>(stmt));
+        case StmtKind::IF: return visitIfStmt(*static_cast<IfStmt*>(stmt));
+        case StmtKind::WHILE: return visitWhileStmt(*static_cast<WhileStmt*>(stmt));
+        case StmtKind::FUNCTION: return visitFunctionStmt(*static_cast<FunctionStmt*>(stmt));
+        case StmtKind::RETURN: return visitReturnStmt(*static_cast<ReturnStmt*>(stmt));
+        case StmtKind::IMPORT: return visitImportStmt(*static_cast<ImportStmt*>(stmt));
+    }
 }
 
-Value* Interpreter::lookUpVariable(Token name, Expr* expr){
-    auto distance = locals.find(expr); 
-    if(distance != locals.end()){
-        return environment->getAt(distance->second, name);
+Value Interpreter::lookUpVariable(const Name& name, Access access, int slot){
+    Value value;
+    switch (access) {
+        case Access::LOCAL: value = environment->slots[slot].value; break;
+        case Access::CELL: value = environment->slots[slot].cell->value; break;
+        case Access::UPVALUE: value = environment->upvalues[slot]->value; break;
+        case Access::GLOBAL: return globals->get(slot, name);
     }
+    if (value.defined()) return value;
 
-    return globals->get(name); 
+    throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme()) +"'.");
 }
 
-void Interpreter::resolve(Expr* expr, int depth){
-    locals[expr] = depth;
+// Where a declaration puts its value. A captured local gets a new cell each
+// time, so closures made in different iterations of a loop don't share it.
+void Interpreter::define(Access access, int slot, Value value){
+    switch (access) {
+        case Access::LOCAL: environment->slots[slot].value = value; break;
+        case Access::CELL: environment->slots[slot].cell = new Cell{value}; break;
+        case Access::UPVALUE: break;
+        case Access::GLOBAL: globals->define(slot, value); break;
+    }
 }
 
 Interpreter::~Interpreter(){}
 
 Interpreter::Interpreter(){
-    this->globals->define("clock", new Value(new ClockCallable()) );
+    this->builtins->define(builtins->slot(symbols.intern("clock")), Value(new ClockCallable()) );
 }
 
 
-void Interpreter::executeBlock(std::vector<Statement*> statements, Environment* environment) {
+void Interpreter::executeBlock(const List<Statement*>& statements, Environment* environment) {
     Environment* previous = this->environment;
     this->environment = environment;
 
@@ -64,50 +102,89 @@ void Interpreter::executeBlock(std::vector<Statement*> statements, Environment*
     this->environment = previous;
 }
 
-void Interpreter::interpret(std::vector<Statement*> statements){
+void Interpreter::interpret(const List<Statement*>& statements, uint32_t locals){
+    FrameStack::Mark mark = stack.mark();
+    Globals* previousGlobals = globals;
+    Environment frame(stack.push(locals));
     try{
-        for (Statement* statement: statements){
-            execute(statement);
-        }
+        executeBlock(statements, &frame);
     } catch(RuntimeError err) {
+        environment = nullptr;
+        globals = previousGlobals;
         error(err.token.line, err.message);
     }
+    stack.release(mark);
 }
 
-Value* Interpreter::visitBinary(Binary& expr) {
-    Value* left = evaluate(&expr.left);        
-    Value* right = evaluate(&expr.right);        
+// An expression TypeInference proved to be a number. Arithmetic on numbers
+// is done in doubles, without checking or boxing the intermediate results.
+double Interpreter::evaluateNumber(Expr* expr){
+    if (expr->kind == ExprKind::BINARY && static_cast<Binary*>(expr)->numeric) {
+        Binary& binary = *static_cast<Binary*>(expr);
+        double a, b;
+        switch (binary.oper.type) {
+            case TokenType::MINUS: a = evaluateNumber(binary.left); b = evaluateNumber(binary.right); return a - b;
+            case TokenType::SLASH: a = evaluateNumber(binary.left); b = evaluateNumber(binary.right); return a / b;
+            case TokenType::STAR: a = evaluateNumber(binary.left); b = evaluateNumber(binary.right); return a * b;
+            case TokenType::PLUS: a = evaluateNumber(binary.left); b = evaluateNumber(binary.right); return a + b;
+            default: break;
+        }
+    }
+    return evaluate(expr).number();
+}
+
+Value Interpreter::visitBinary(Binary& expr) {
+    if (expr.numeric) {
+        double a = evaluateNumber(expr.left);
+        double b = evaluateNumber(expr.right);
+        switch (expr.oper.type) {
+            case TokenType::GREATER: return Value(a > b);
+            case TokenType::GREATER_EQUAL: return Value(a >= b);
+            case TokenType::LESS: return Value(a < b);
+            case TokenType::LESS_EQUAL: return Value(a <= b);
+            case TokenType::MINUS: return Value(a - b);
+            case TokenType::SLASH: return Value(a / b);
+            case TokenType::STAR: return Value(a * b);
+            case TokenType::PLUS: return Value(a + b);
+            case TokenType::BANG_EQUAL: return Value(a != b);
+            case TokenType::EQUAL_EQUAL: return Value(a == b);
+            default: break;
+        }
+    }
+
+    Value left = evaluate(expr.left);        
+    Value right = evaluate(expr.right);        
 
     //switch based on the type too
-    if(left->type == ValueType::NUMBER && right->type == ValueType::NUMBER){
+    if(left.type() == ValueType::NUMBER && right.type() == ValueType::NUMBER){
         switch (expr.oper.type) {
             case TokenType::GREATER:
-                return new Value(left->number > right->number);
+                return Value(left.number() > right.number());
             case TokenType::GREATER_EQUAL:
-                return new Value(left->number >= right->number);
+                return Value(left.number() >= right.number());
             case TokenType::LESS:
-                return new Value(left->number < right->number);
+                return Value(left.number() < right.number());
             case TokenType::LESS_EQUAL:
-                return new Value(left->number <= right->number);
+                return Value(left.number() <= right.number());
             case TokenType::MINUS:
-                return new Value(left->number - right->number);
+                return Value(left.number() - right.number());
             case TokenType::SLASH:
-                return new Value(left->number / right->number);
+                return Value(left.number() / right.number());
             case TokenType::STAR:
-                return new Value(left->number * right->number);
+                return Value(left.number() * right.number());
             case TokenType::PLUS:
-                return new Value(left->number + right->number);
+                return Value(left.number() + right.number());
 
-            case TokenType::BANG_EQUAL: return new Value(!(isEqual(left, right)));
-            case TokenType::EQUAL_EQUAL: return new Value(isEqual(left, right));
+            case TokenType::BANG_EQUAL: return Value(!(isEqual(left, right)));
+            case TokenType::EQUAL_EQUAL: return Value(isEqual(left, right));
         }
-    } else if(left->type == ValueType::STRING && right->type == ValueType::STRING){
+    } else if(left.type() == ValueType::STRING && right.type() == ValueType::STRING){
         switch (expr.oper.type){
             case TokenType::PLUS:
-                return new Value(left->str + right->str);
+                return Value(left.str() + right.str());
 
-            case TokenType::BANG_EQUAL: return new Value(!( isEqual(left, right)));
-            case TokenType::EQUAL_EQUAL: return new Value(isEqual(left, right));
+            case TokenType::BANG_EQUAL: return Value(!( isEqual(left, right)));
+            case TokenType::EQUAL_EQUAL: return Value(isEqual(left, right));
         }
     } 
 
@@ -119,60 +196,55 @@ Value* Interpreter::visitBinary(Binary& expr) {
 }
 
 
-Value* Interpreter::visitGrouping(Grouping& expr) {
-    return evaluate(&expr.expression);
+Value Interpreter::visitGrouping(Grouping& expr) {
+    return evaluate(expr.expression);
 }
 
-Value* Interpreter::visitLiteral(Literal& expr) {
-    //just conv from token to Value for now.
-    switch (expr.type){
-        case TokenType::NUMBER:
-            return new Value(std::stod(expr.value)); 
-        case TokenType::STRING:
-            return new Value(expr.value);
-        case TokenType::TRUE:
-            return new Value(true);
-        case TokenType::FALSE:
-            return new Value(false);
-    }
-    
-    return new Value(); //NIL
+Value Interpreter::visitLiteral(Literal& expr) {
+    return expr.value;
 }
 
 
-Value* Interpreter::visitUnary(Unary& expr) {
-    Value* right = evaluate(&expr.right);
+Value Interpreter::visitUnary(Unary& expr) {
+    Value right = evaluate(expr.right);
     switch(expr.oper.type){
         case TokenType::MINUS :
-            return new Value(-right->number);
+            return Value(-right.number());
         case TokenType::BANG:
-            return new Value(!isTruthy(right));
+            return Value(!isTruthy(right));
     }
 
-    return new Value(); //NIL
+    return Value(); //NIL
 
 }
 
-Value* Interpreter::visitVariable(Variable& expr){ 
-    return lookUpVariable(expr.name, &expr);
+Value Interpreter::visitVariable(Variable& expr){ 
+    return lookUpVariable(expr.name, expr.access, expr.slot);
 }
 
 
-Value* Interpreter::visitAssign(Assign& expr){
-    Value* value = evaluate(expr.value);
+Value Interpreter::visitAssign(Assign& expr){
+    Value value = evaluate(expr.value);
 
-    auto distance = locals.find(&expr);  
-    if (distance != locals.end()){
-        environment->assignAt(distance->second, expr.name, value);
-    } else {
-        globals->assign(expr.name, value);
-    
+    if (Memo::enabled) {
+        switch (expr.access) {
+            case Access::LOCAL: Memo::rebind(environment->slots[expr.slot].value, value); break;
+            case Access::CELL: Memo::rebind(environment->slots[expr.slot].cell->value, value); break;
+            case Access::UPVALUE: Memo::rebind(environment->upvalues[expr.slot]->value, value); break;
+            case Access::GLOBAL: break;
+        }
+    }
+    switch (expr.access) {
+        case Access::LOCAL: environment->slots[expr.slot].value = value; break;
+        case Access::CELL: environment->slots[expr.slot].cell->value = value; break;
+        case Access::UPVALUE: environment->upvalues[expr.slot]->value = value; break;
+        case Access::GLOBAL: globals->assign(expr.slot, expr.name, value); break;
     }
     return value; 
 }
 
-Value* Interpreter::visitLogicalExpr(Logical& expr){
-    Value* left = evaluate(expr.left);
+Value Interpreter::visitLogicalExpr(Logical& expr){
+    Value left = evaluate(expr.left);
 
     if(expr.oper.type == TokenType::OR){ 
         if(isTruthy(left)) return left; 
@@ -182,35 +254,83 @@ Value* Interpreter::visitLogicalExpr(Logical& expr){
     return evaluate(expr.right);
 }
 
-Value* Interpreter::visitCallExpr(Call& expr){
-    Value* callee = evaluate(expr.callee); //canat be value then, hmm
-    std::vector<Value*> arguments;
+Value Interpreter::visitCallExpr(Call& expr){
+    Value callee = evaluate(expr.callee); //canat be value then, hmm
+    return call(expr, callee);
+}
+
+Value Interpreter::call(Call& expr, Value callee){
+    std::vector<Value> arguments = evaluateArguments(expr);
+    return callable(expr, callee, arguments.size())->call(this, arguments);
+}
+
+std::vector<Value> Interpreter::evaluateArguments(Call& expr){
+    std::vector<Value> arguments;
     for (Expr* argument : expr.arguments) {
         arguments.push_back(evaluate(argument));
     }
+    return arguments;
+}
 
-    if (callee->type != ValueType::CALLABLE) { 
+// what `callee` is, if it can be called with that many arguments
+LoxCallable* Interpreter::callable(Call& expr, Value callee, size_t arguments){
+    if (callee.type() != ValueType::CALLABLE) { 
         throw RuntimeError(expr.paren,
         "Can only call functions and classes.");
     }
 
-    LoxCallable* function = callee->callable;
-    if (arguments.size() != function->arity()) {
+    LoxCallable* function = callee.callable();
+    if (arguments != function->arity()) {
         throw RuntimeError(expr.paren, "Expected " +
         std::to_string(function->arity()) + " arguments but got " +
-        std::to_string(arguments.size()) + ".");
+        std::to_string(arguments) + ".");
+    }
+    return function;
+}
+
+// The body was copied from expr.function, so it only stands in for the call
+// while the callee is a closure of that declaration; anything else is called.
+Value Interpreter::visitInline(Inline& expr){
+    Value callee = evaluate(expr.call->callee);
+    LoxFunction* function = nullptr;
+    if (callee.type() == ValueType::CALLABLE) {
+        if (callee.callable() == expr.seen) {
+            function = static_cast<LoxFunction*>(expr.seen);
+        } else {
+            function = dynamic_cast<LoxFunction*>(callee.callable());
+            if (function != nullptr && function->declaration != expr.function) function = nullptr;
+            else expr.seen = function;
+        }
     }
-    //definte the function
-    // std::cout << expr.paren.toString() << std::endl; 
-    this->globals->define(expr.paren.lexeme, new Value(function));
-    // std::cout << this->environment->get(expr.paren)->view() << std::endl;
-    return function->call(this, arguments);
+    if (function == nullptr) return call(*expr.call, callee);
+
+    // the parameters live in this frame, from expr.base on
+    for (size_t i = 0; i < expr.call->arguments.size(); i++) {
+        environment->slots[expr.base + i].value = evaluate(expr.call->arguments[i]);
+    }
+    Environment* previous = environment;
+    Environment frame(environment->slots, function->upvalues.data());
+    environment = &frame;
+    Value value = evaluate(expr.body);
+    environment = previous;
+    return value;
 }
 
 
 void Interpreter::visitFunctionStmt(FunctionStmt& stmt){
-    LoxFunction* function = new LoxFunction(stmt, this->environment);
-    this->environment->define(stmt.name.lexeme, new Value(function));
+    // a function that captures itself needs its cell before it is made
+    Cell* self = nullptr;
+    if (stmt.access == Access::CELL) environment->slots[stmt.slot].cell = self = new Cell{Value::undefined()};
+
+    std::vector<Cell*> upvalues;
+    upvalues.reserve(stmt.upvalues.size());
+    for (const Upvalue& upvalue : stmt.upvalues) {
+        upvalues.push_back(upvalue.local ? environment->slots[upvalue.index].cell
+                                         : environment->upvalues[upvalue.index]);
+    }
+    Value function(new LoxFunction(stmt, std::move(upvalues)));
+    if (self != nullptr) self->value = function;
+    else define(stmt.access, stmt.slot, function);
     return;
 } 
 
@@ -220,24 +340,20 @@ void Interpreter::visitExprStmt(ExprStmt& stmt) {
 }
 
 void Interpreter::visitPrintStmt(PrintStmt& stmt) {
-    Value* value = evaluate(stmt.expression);
-    std::cout << value->view() << std::endl;
+    Value value = evaluate(stmt.expression);
+    std::cout << value.view() << std::endl;
     return;
 }
 
 
 void Interpreter::visitVarStmt(VarStmt& stmt){
-    Value* value = new Value();
-    if (stmt.initializer != nullptr){
-        value = evaluate(stmt.initializer); 
-        environment->define(stmt.name.lexeme, value);
-        return;
-    } 
-        environment->define(stmt.name.lexeme, new Value());
+    Value value = stmt.initializer != nullptr ? evaluate(stmt.initializer) : Value();
+    define(stmt.access, stmt.slot, value);
 }
 
 void Interpreter::visitBlockStmt(BlockStmt& stmt){
-    executeBlock(stmt.statements, new Environment(environment));
+    // its locals have slots in the frame of the function it is in
+    for (Statement* statement : stmt.statements) execute(statement);
     return; 
 }
 
@@ -257,8 +373,45 @@ void Interpreter::visitWhileStmt(WhileStmt& stmt) {
     return;
 }
 
+// The first import of a module runs it, in globals of its own. A module
+// imported again while it is still running (a cycle) exports what it has
+// defined so far.
+void Interpreter::visitImportStmt(ImportStmt& stmt){
+    Module* module = modules->load(stmt);
+    if (!module->ran) {
+        module->ran = true;
+        Globals* previousGlobals = globals;
+        Environment* previous = environment;
+        FrameStack::Mark mark = stack.mark();
+        Environment frame(stack.push(module->unit->locals));
+        globals = module->unit->globals;
+        environment = &frame;
+        try {
+            for (Statement* statement : module->unit->statements) execute(statement);
+        } catch (...) {
+            globals = previousGlobals;
+            environment = previous;
+            stack.release(mark);
+            throw;
+        }
+        globals = previousGlobals;
+        environment = previous;
+        stack.release(mark);
+    }
+    globals->import(*module->unit->globals, module->exports);
+}
+
 void Interpreter::visitReturnStmt(ReturnStmt& stmt){
-    Value* value = new Value();
+    if (stmt.tailCall) {
+        Call& call = *static_cast<Call*>(stmt.value);
+        Value callee = evaluate(call.callee);
+        std::vector<Value> arguments = evaluateArguments(call);
+        LoxCallable* function = callable(call, callee, arguments.size());
+        LoxFunction* next = dynamic_cast<LoxFunction*>(function);
+        if (next != nullptr) throw Return(next, std::move(arguments));
+        throw Return(function->call(this, arguments));
+    }
+    Value value;
     if (stmt.value != nullptr) value = evaluate(stmt.value);
     throw Return(value);
 }
@@ -9,38 +9,49 @@
 #include "clockcallable.hpp"
 
 
-class Interpreter: public ExprVisitor, public StmtVisitor {
+class ModuleLoader;
+
+class Interpreter final: public ExprVisitor, public StmtVisitor {
 
 private: 
-    Value* evaluate(Expr* expr);
-    bool isTruthy(Value* value);
-    bool isEqual(Value* a, Value* b);
+    Value evaluate(Expr* expr);
+    double evaluateNumber(Expr* expr);
+    bool isTruthy(Value value);
+    bool isEqual(Value a, Value b);
     void execute(Statement* stmt);
+    Value call(Call& expr, Value callee);
+    std::vector<Value> evaluateArguments(Call& expr);
+    LoxCallable* callable(Call& expr, Value callee, size_t arguments);
 
 public:
 
-    Environment* globals = new Environment();
-    Environment* environment = new Environment(globals);
-
-
-     std::unordered_map<Expr*, int> locals; //stack
+    // builtins back the globals of the script and of each module; `globals`
+    // are those of the code running now
+    Globals* builtins = new Globals();
+    Globals* globals = new Globals(builtins);
+    // the frame of the code running, and where frames get their slots
+    Environment* environment = nullptr;
+    FrameStack stack;
+    ModuleLoader* modules = nullptr;
 
     ~Interpreter();
     Interpreter();
 
-    void executeBlock(std::vector<Statement*> statements, Environment* environment) ;
-    void interpret(std::vector<Statement*> statements);
-    void resolve(Expr* expr, int depth);
-    Value* lookUpVariable(Token name, Expr* expr);
+    void executeBlock(const List<Statement*>& statements, Environment* environment) ;
+    // `locals` is the size of the frame of the top-level code
+    void interpret(const List<Statement*>& statements, uint32_t locals);
+    Value lookUpVariable(const Name& name, Access access, int slot);
+    void define(Access access, int slot, Value value);
 
-    Value* visitBinary(Binary& expr);
-    Value* visitGrouping(Grouping& expr) ;
-    Value* visitLiteral(Literal& expr) ;
-    Value* visitUnary(Unary& expr) ;
-    Value* visitVariable(Variable& expr);
-    Value* visitAssign(Assign& expr);
-    Value* visitLogicalExpr(Logical& expr);
-    Value* visitCallExpr(Call& expr);
+    Value visitBinary(Binary& expr);
+    Value visitGrouping(Grouping& expr) ;
+    Value visitLiteral(Literal& expr) ;
+    Value visitUnary(Unary& expr) ;
+    Value visitVariable(Variable& expr);
+    Value visitAssign(Assign& expr);
+    Value visitLogicalExpr(Logical& expr);
+    Value visitCallExpr(Call& expr);
+    Value visitInline(Inline& expr);
 
     void visitFunctionStmt(FunctionStmt& stmt);
     void visitExprStmt(ExprStmt& stmt);
@@ -50,6 +61,7 @@ public:
     void visitIfStmt(IfStmt& stmt);
     void visitWhileStmt(WhileStmt& stmt) ;
     void visitReturnStmt(ReturnStmt& stmt);
+    void visitImportStmt(ImportStmt& stmt);
 
 };
 
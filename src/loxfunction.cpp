@@ -1,26 +1,111 @@
+#include <algorithm>
+
 #include "loxfunction.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+#include "passes.hpp"
+#include "purity.hpp"
 
+// the declarations being compiled on this thread
+static thread_local std::vector<FunctionStmt*> inProgress;
 
-Value* LoxFunction::call(Interpreter* interpreter,  std::vector<Value*> arguments) {
-    Environment* environment = new Environment(this->closure);
-    Environment* previous = interpreter->environment;
-    interpreter->environment = environment;
-    
-    for (int i = 0; i < declaration->params.size(); i++) {
-        environment->define(declaration->params.at(i).lexeme, arguments.at(i));
+// Parses and resolves a pre-parsed body, then runs the passes on it. Its syntax
+// was checked when the unit was loaded, but resolution errors in it only show
+// up now. They are reported once; the body is dropped and later calls only
+// throw.
+void LoxFunction::compile(FunctionStmt& declaration) {
+    const std::string failure = "Can't compile <fn " + std::string(declaration.name.lexeme()) + ">.";
+    if (declaration.failed) throw RuntimeError(declaration.name, failure);
+    CompilationUnit& unit = *declaration.unit;
+    LazyBody& lazy = *declaration.lazy;
+
+    Scanner scanner(unit.source->text().substr(lazy.offset));
+    scanner.startLine(lazy.line);
+    Parser parser(scanner, unit.constants, unit);
+    parser.lazy = true;
+    declaration.body = parser.parseBody();
+
+    bool hadErrorBefore = hadError;
+    hadError = false;
+    Resolver resolver(*unit.globals);
+    resolver.resolveBody(declaration);
+    bool failed = hadError;
+    hadError = hadErrorBefore;
+    if (failed) {
+        declaration.failed = true;
+        declaration.body = List<Statement*>();
+        throw RuntimeError(declaration.name, failure);
+    }
+    inProgress.push_back(&declaration);
+    Code code{unit, declaration.body, declaration.locals, &declaration};
+    PassManager::pipeline().run(code);
+    inProgress.pop_back();
+    declaration.lazy = nullptr;
+}
+
+bool LoxFunction::compiling(FunctionStmt& declaration) {
+    return std::find(inProgress.begin(), inProgress.end(), &declaration) != inProgress.end();
+}
 
+// A `return f(...);` comes back as a Return holding the call, which is made
+// here in a frame put where this one was, so tail calls run in constant stack.
+// With --memoize-pure the result of the whole chain is kept for this function.
+Value LoxFunction::call(Interpreter* interpreter,  std::vector<Value> arguments) {
+    bool memoized = false;
+    std::vector<Value> key;
+    if (Memo::enabled && !Memo::stopped) {
+        if (declaration->lazy != nullptr) compile(*declaration);
+        if (Memo::scalars(arguments) && Purity::memoizable(*declaration)) {
+            if (memo == nullptr) memo = std::make_unique<Memo>();
+            Value result = memo->find(arguments);
+            if (result.defined()) return result;
+            memoized = true;
+            key = arguments;
+        }
     }
-    try{ 
-        interpreter->executeBlock(declaration->body, environment);
-    } catch(Return returnValue){
-        // for (int i = 0; i < declaration->params.size(); i++) 
-        //     std::cout <<  declaration->params.at(i).lexeme << " " << arguments.at(i)->view() << "\t";
 
-        // std::cout << this->toString() << " " << returnValue.value->view() << std::endl;
+    FrameStack::Mark mark = interpreter->stack.mark();
+    Environment* previous = interpreter->environment;
+    Globals* previousGlobals = interpreter->globals;
+    LoxFunction* function = this;
+    Value result = Value::undefined();
+
+    while (!result.defined()) {
+        FunctionStmt* declaration = function->declaration;
+        if (declaration->lazy != nullptr) compile(*declaration);
+
+        Environment frame(interpreter->stack.push(declaration->locals), function->upvalues.data());
+        Environment* environment = &frame;
+        interpreter->environment = environment;
+        // those of the module it was declared in
+        interpreter->globals = function->unit->globals;
+
+        for (size_t i = 0; i < declaration->params.size(); i++) {
+            if (declaration->cellParams[i]) environment->slots[i].cell = new Cell{arguments.at(i)};
+            else environment->slots[i].value = arguments.at(i);
+
+        }
+        try{ 
+            interpreter->executeBlock(declaration->body, environment);
+            result = Value();
+        } catch(Return& returnValue){
+            // for (int i = 0; i < declaration->params.size(); i++) 
+            //     std::cout <<  declaration->params.at(i).lexeme << " " << arguments.at(i)->view() << "\t";
+
+            // std::cout << this->toString() << " " << returnValue.value->view() << std::endl;
 
-        interpreter->environment = previous;
-        return returnValue.value;
+            if (returnValue.callee != nullptr) {
+                function = returnValue.callee;
+                arguments = std::move(returnValue.arguments);
+                interpreter->stack.release(mark);
+            } else {
+                result = returnValue.value;
+            }
+        }
     }
     interpreter->environment = previous;
-    return new Value();
-}
\ No newline at end of file
+    interpreter->globals = previousGlobals;
+    interpreter->stack.release(mark);
+    if (memoized) memo->insert(key, result);
+    return result;
+}
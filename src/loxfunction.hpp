@@ -5,20 +5,35 @@
 #include "error.hpp"
 #include "environment.hpp"
 #include "interpreter.hpp"
+#include "unit.hpp"
+#include "memo.hpp"
 
 class LoxFunction : public LoxCallable {
 public:
 
-    Value* call(Interpreter* interpreter, std::vector<Value*> arguments) ;
+    Value call(Interpreter* interpreter, std::vector<Value> arguments) ;
     int arity() { return declaration->params.size();};
-    std::string toString() {return "<fn " + declaration->name.lexeme + ">" ;};
+    std::string toString() {return "<fn " + std::string(declaration->name.lexeme()) + ">" ;};
 
-    LoxFunction(FunctionStmt& declaration, Environment* closure) : declaration(&declaration), closure(closure) {};
+    LoxFunction(FunctionStmt& declaration, std::vector<Cell*> upvalues)
+        : declaration(&declaration), unit(declaration.unit->shared_from_this()), upvalues(std::move(upvalues)) {};
+
+    // parses the body of a function that was only pre-parsed
+    static void compile(FunctionStmt& declaration);
+    // true while it is being compiled, when it must not be inlined into itself
+    static bool compiling(FunctionStmt& declaration);
 
 private: 
+    friend class Interpreter;
+
     FunctionStmt* declaration;
-    Environment* closure;
-    
+    // the declaration lives in the unit's arena
+    std::shared_ptr<CompilationUnit> unit;
+    // the variables it captured, in the order of declaration->upvalues
+    std::vector<Cell*> upvalues;
+    // --memoize-pure, once it is known to be pure and called with scalars
+    std::unique_ptr<Memo> memo;
+
 };
 
 
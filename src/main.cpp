@@ -4,34 +4,49 @@
 #include <fstream>
 #include <cctype>
 #include <unordered_map>
+#include <thread>
 
 #include "types.hpp"
 #include "error.hpp"
+#include "source.hpp"
+#include "unit.hpp"
+#include "cache.hpp"
+#include "module.hpp"
+#include "memo.hpp"
 
 #include "loxfunction.cpp"
 #include "scanner.cpp"
 #include "parser.cpp"
 #include "resolver.cpp"
+#include "optimizer.cpp"
+#include "inliner.cpp"
+#include "inference.cpp"
+#include "hoister.cpp"
+#include "purity.cpp"
+#include "passes.cpp"
 #include "interpreter.cpp"
 #include "clockcallable.cpp"
+#include "cache.cpp"
+#include "module.cpp"
 
 Interpreter* interpreter = new Interpreter();
 
+// Runtime values can alias literals, so the pool outlives the units.
+ConstantPool constants;
 
-void run(const std::string& source) {
-    Scanner scanner(source);
-    std::vector<Token> tokens = scanner.scanTokens();
-    Parser* parser = new Parser(tokens);
-    std::vector<Statement*> statements = parser->parse();
 
-    if (hadError) return;
+ModuleLoader modules(constants);
 
-    Resolver resolver(interpreter);
-    resolver.resolve(statements);
 
-    if (hadError) return;
+// `path` is empty for REPL lines
+void run(Source* source, const std::string& path, bool implicitBlock) {
+    std::shared_ptr<CompilationUnit> unit = modules.compile(source, path, implicitBlock, interpreter->globals);
+    if (unit == nullptr) return;
+
+    // everything it imports is compiled before it starts
+    if (!modules.prepare(*unit)) return;
     
-    interpreter->interpret(statements);
+    interpreter->interpret(unit->statements, unit->locals);
 
 
     // PrettyPrinter p;
@@ -48,26 +63,13 @@ void run(const std::string& source) {
 
 void runFile(char* path){
 
-    std::ifstream file;
-    file.open(path);
-    if (!file.is_open()) {
+    Source* source = Source::load(path);
+    if (source == nullptr) {
         std::cerr << "Error: Could not open file " << path << std::endl;
         return;
     }
 
-    file.seekg(0, std::ios::end);
-    std::streampos fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    // Read the entire file content into a string
-    std::string fileContents;
-    fileContents.resize(fileSize);
-    file.read(&fileContents[0], fileSize);
-    file.close();
-
-    fileContents = "{" + fileContents + "}";
-
-    run(fileContents);
+    run(source, path, true);
 }
 
 void runPrompt() {
@@ -81,21 +83,50 @@ void runPrompt() {
             break;
         }
 
-        run(line);
+        run(new Source(line), "", false);
         hadError = false;
     }
 }
 
 int main(int argc, char* argv[]){
 
-    if (argc > 2){
-        std::cout << "Usage: cpplox [script] \n";
+    bool useCache = true;
+    bool usage = false;
+    char* script = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--no-cache") {
+            useCache = false;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            PassManager::options.level = arg[2] - '0';
+        } else if (arg == "--time-passes") {
+            PassManager::options.timePasses = true;
+        } else if (arg == "--memoize-pure") {
+            Memo::enabled = true;
+        } else if (arg.rfind("--dump-after=", 0) == 0 && PassManager::known(arg.substr(13))) {
+            PassManager::options.dumpAfter = arg.substr(13);
+        } else if (script == nullptr && arg[0] != '-') {
+            script = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+
+    interpreter->modules = &modules;
+    modules.builtins = interpreter->builtins;
+    // a cached unit skips the passes, so it would be missing from both
+    modules.useCache = useCache && !PassManager::options.timePasses && PassManager::options.dumpAfter.empty();
+
+    if (usage){
+        std::cout << "Usage: cpplox [--no-cache] [-O0|-O1|-O2] [--time-passes] [--dump-after=<pass>] [--memoize-pure] [script] \n";
         return 0;
-    } else if (argc == 2){
-        runFile(argv[1]);
+    } else if (script != nullptr){
+        runFile(script);
     } else{
         runPrompt();
     }
+    if (PassManager::options.timePasses) PassManager::report(std::cerr);
+    if (Memo::enabled) Memo::report(std::cerr);
 
     // Token minusToken(TokenType::MINUS, "-", "", 1);
     // Token starToken(TokenType::STAR, "*", "", 1);
@@ -0,0 +1,110 @@
+#ifndef MEMO_H_
+#define MEMO_H_
+
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+
+// --memoize-pure: the results a pure function gave, by its arguments. Only
+// calls with numbers, strings, booleans and nil are looked up, and only such
+// results are kept, as a new function made by a call must stay new. A table
+// that fills up is emptied.
+//
+// Whether a function is pure is worked out from the functions the Resolver
+// saw it call, so once any variable that held a function is given another
+// one, which a pure function may be calling, nothing is memoized any more.
+class Memo {
+public:
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    // set from the command line
+    static bool enabled;
+    // a function was rebound
+    static bool stopped;
+
+    // the result of an earlier call with `arguments`, or undefined
+    Value find(const std::vector<Value>& arguments) {
+        auto it = results.find(arguments);
+        if (it == results.end()) {
+            misses++;
+            return Value::undefined();
+        }
+        hits++;
+        return it->second;
+    }
+
+    void insert(const std::vector<Value>& arguments, Value result) {
+        if (stopped || !scalar(result)) return;
+        if (results.size() >= CAPACITY) results.clear();
+        results.emplace(arguments, result);
+    }
+
+    static bool scalar(Value value) {
+        return value.type() != ValueType::CALLABLE;
+    }
+
+    static bool scalars(const std::vector<Value>& values) {
+        for (Value value : values) if (!scalar(value)) return false;
+        return true;
+    }
+
+    // a variable that held `previous` is given `value`
+    static void rebind(Value previous, Value value) {
+        if (previous.type() == ValueType::CALLABLE && value.raw() != previous.raw())
+            stopped = true;
+    }
+
+    static void report(std::ostream& out) {
+        size_t calls = hits + misses;
+        out << "memoize-pure: " << functions << " functions, " << hits << " hits in " << calls << " calls ("
+            << std::fixed << std::setprecision(1) << (calls == 0 ? 0.0 : 100.0 * hits / calls) << "%)"
+            << std::defaultfloat << (stopped ? ", stopped after a function was rebound" : "") << std::endl;
+    }
+
+    Memo() { functions++; }
+
+private:
+    // numbers by their bits, so that 0 and -0 are told apart, and strings by
+    // their text
+    struct Hash {
+        size_t operator()(const std::vector<Value>& arguments) const {
+            size_t h = arguments.size();
+            for (Value value : arguments) {
+                size_t item = value.type() == ValueType::STRING ? std::hash<std::string>()(value.str())
+                                                                : std::hash<uint64_t>()(value.raw());
+                h = h * 31 + item;
+            }
+            return h;
+        }
+    };
+
+    struct Equal {
+        bool operator()(const std::vector<Value>& a, const std::vector<Value>& b) const {
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); i++) {
+                if (a[i].raw() == b[i].raw()) continue;
+                if (a[i].type() != ValueType::STRING || b[i].type() != ValueType::STRING) return false;
+                if (a[i].str() != b[i].str()) return false;
+            }
+            return true;
+        }
+    };
+
+    std::unordered_map<std::vector<Value>, Value, Hash, Equal> results;
+
+    static size_t functions;
+    static size_t hits;
+    static size_t misses;
+};
+
+inline bool Memo::enabled = false;
+inline bool Memo::stopped = false;
+inline size_t Memo::functions = 0;
+inline size_t Memo::hits = 0;
+inline size_t Memo::misses = 0;
+
+#endif //MEMO_H_
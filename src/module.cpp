@@ -0,0 +1,172 @@
+#include "module.hpp"
+#include "scanner.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+#include "passes.hpp"
+#include "cache.hpp"
+#include "memo.hpp"
+
+namespace fs = std::filesystem;
+
+std::shared_ptr<CompilationUnit> ModuleLoader::compile(Source* source, const std::string& path, bool implicitBlock, Globals* globals) {
+    std::shared_ptr<CompilationUnit> unit = std::make_shared<CompilationUnit>(source, constants);
+    unit->path = path;
+    unit->globals = globals;
+
+    std::unique_ptr<ScriptCache> cache;
+    if (useCache && !path.empty()) {
+        cache = std::make_unique<ScriptCache>(path.c_str(), source->text(), implicitBlock, PassManager::options.level, Memo::enabled);
+        if (cache->load(*unit)) return unit;
+    }
+
+    hadError = false;
+    Scanner scanner(source->text());
+    scanner.implicitBlock = implicitBlock;
+    scanner.threads = std::thread::hardware_concurrency();
+    Parser parser(scanner, constants, *unit);
+    parser.lazy = true;
+    unit->statements = parser.parse();
+
+    if (hadError) return nullptr;
+
+    Resolver resolver(*globals);
+    resolver.resolve(*unit);
+
+    if (hadError) return nullptr;
+
+    Code code{*unit, unit->statements, unit->locals, nullptr};
+    PassManager::pipeline().run(code);
+
+    if (cache != nullptr) cache->save(*unit);
+    return unit;
+}
+
+bool ModuleLoader::prepare(CompilationUnit& unit) {
+    std::vector<Import> found;
+    imports(unit.statements, found);
+    if (found.empty()) return true;
+
+    for (const Import& import : found) schedule(import);
+    return wait();
+}
+
+Module* ModuleLoader::load(ImportStmt& stmt) {
+    std::string path = resolve(stmt);
+    std::error_code error;
+    fs::file_time_type mtime = fs::last_write_time(path, error);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = modules.find(path);
+        if (it != modules.end() && it->second->unit != nullptr && !error && it->second->mtime == mtime)
+            return it->second.get();
+    }
+
+    // imported from a body parsed after its script started, or changed since
+    schedule({path, stmt.keyword.line});
+    wait();
+
+    std::lock_guard<std::mutex> guard(lock);
+    Module* module = modules[path].get();
+    if (module->unit == nullptr)
+        throw RuntimeError(stmt.keyword, "Could not import '" + std::string(stmt.path.literal()) + "'.");
+    return module;
+}
+
+// relative to the directory of the importing file, or the working directory
+std::string ModuleLoader::resolve(ImportStmt& stmt) {
+    fs::path path = fs::path(stmt.unit->path).parent_path() / fs::path(std::string(stmt.path.literal()));
+    std::error_code error;
+    fs::path canonical = fs::weakly_canonical(fs::absolute(path, error), error);
+    return error ? path.string() : canonical.string();
+}
+
+// Imports anywhere in the statements, except in bodies not parsed yet. Those
+// are loaded when they run.
+void ModuleLoader::imports(const List<Statement*>& statements, std::vector<Import>& found) {
+    for (Statement* statement : statements) imports(statement, found);
+}
+
+void ModuleLoader::imports(Statement* statement, std::vector<Import>& found) {
+    if (statement == nullptr) return;
+    switch (statement->kind) {
+        case StmtKind::IMPORT: {
+            ImportStmt* import = static_cast<ImportStmt*>(statement);
+            found.push_back({resolve(*import), import->keyword.line});
+            break;
+        }
+        case StmtKind::BLOCK:
+            imports(static_cast<BlockStmt*>(statement)->statements, found);
+            break;
+        case StmtKind::IF:
+            imports(static_cast<IfStmt*>(statement)->thenBranch, found);
+            imports(static_cast<IfStmt*>(statement)->elseBranch, found);
+            break;
+        case StmtKind::WHILE:
+            imports(static_cast<WhileStmt*>(statement)->body, found);
+            break;
+        case StmtKind::FUNCTION:
+            imports(static_cast<FunctionStmt*>(statement)->body, found);
+            break;
+        default:
+            break;
+    }
+}
+
+// Queues a module for building unless it is already compiled and unchanged,
+// or already queued.
+void ModuleLoader::schedule(const Import& import) {
+    std::error_code error;
+    fs::file_time_type mtime = fs::last_write_time(import.path, error);
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::unique_ptr<Module>& slot = modules[import.path];
+    if (slot != nullptr && (!slot->compiled || (slot->unit != nullptr && !error && slot->mtime == mtime)))
+        return;
+
+    slot = std::make_unique<Module>();
+    slot->path = import.path;
+    slot->mtime = mtime;
+    Module* module = slot.get();
+    pending.push_back(module);
+
+    if (pool == nullptr) pool = std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+    pool->submit([this, module, line = import.line] { build(module, line); });
+}
+
+void ModuleLoader::build(Module* module, int line) {
+    std::shared_ptr<CompilationUnit> unit;
+    Source* source = Source::load(module->path.c_str());
+    if (source == nullptr) {
+        error(line, "Could not open module '" + module->path + "'.");
+    } else {
+        unit = compile(source, module->path, false, new Globals(builtins));
+        if (unit == nullptr) error(line, "Could not compile module '" + module->path + "'.");
+    }
+
+    std::vector<Symbol> exports;
+    if (unit != nullptr) {
+        for (Statement* statement : unit->statements) {
+            if (statement->kind == StmtKind::VAR) exports.push_back(static_cast<VarStmt*>(statement)->name.symbol);
+            if (statement->kind == StmtKind::FUNCTION) exports.push_back(static_cast<FunctionStmt*>(statement)->name.symbol);
+        }
+
+        std::vector<Import> found;
+        imports(unit->statements, found);
+        for (const Import& import : found) schedule(import);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    module->unit = unit;
+    module->exports = std::move(exports);
+    module->compiled = true;
+}
+
+bool ModuleLoader::wait() {
+    if (pool != nullptr) pool->wait();
+
+    std::lock_guard<std::mutex> guard(lock);
+    bool compiled = true;
+    for (Module* module : pending) compiled = compiled && module->unit != nullptr;
+    pending.clear();
+    return compiled;
+}
@@ -0,0 +1,76 @@
+#ifndef MODULE_H_
+#define MODULE_H_
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+#include "unit.hpp"
+#include "environment.hpp"
+#include "constants.hpp"
+#include "threadpool.hpp"
+
+// A script loaded with `import`. Its top-level declarations are globals of its
+// own, in its unit's table, and every import of it copies them into the
+// importer's.
+// Names it imported itself are not passed on.
+struct Module {
+    std::string path;
+    std::filesystem::file_time_type mtime;
+    // null if it couldn't be read or had errors, which were reported
+    std::shared_ptr<CompilationUnit> unit;
+    // its top-level vars and functions
+    std::vector<Symbol> exports;
+    // set when it first starts running
+    bool ran = false;
+    bool compiled = false;
+};
+
+// Compiles scripts, and keeps each imported module compiled for the rest of
+// the process, keyed by its canonical path, until its file's mtime changes.
+// Before a script runs, everything it imports is scanned, parsed and resolved
+// on a thread pool, an import's own imports as soon as it has been parsed.
+class ModuleLoader {
+public:
+    explicit ModuleLoader(ConstantPool& constants) : constants(constants) {}
+
+    // what each module's globals fall back to
+    Globals* builtins = nullptr;
+
+    // use and write .loxc caches for files
+    bool useCache = true;
+
+    // front end for one file (or REPL line, with an empty path), numbering its
+    // globals in `globals`; null on errors
+    std::shared_ptr<CompilationUnit> compile(Source* source, const std::string& path, bool implicitBlock, Globals* globals);
+    // compiles what `unit` imports, transitively; false if any of it failed
+    bool prepare(CompilationUnit& unit);
+    // the compiled module an import names, compiled now if it has to be
+    Module* load(ImportStmt& stmt);
+
+private:
+    struct Import {
+        std::string path;
+        int line;
+    };
+
+    std::string resolve(ImportStmt& stmt);
+    void imports(const List<Statement*>& statements, std::vector<Import>& found);
+    void imports(Statement* statement, std::vector<Import>& found);
+    void schedule(const Import& import);
+    void build(Module* module, int line);
+    bool wait();
+
+    ConstantPool& constants;
+    std::unique_ptr<ThreadPool> pool;
+    std::mutex lock;
+    std::unordered_map<std::string, std::unique_ptr<Module>> modules;
+    // scheduled since the last wait()
+    std::vector<Module*> pending;
+};
+
+#endif //MODULE_H_
@@ -0,0 +1,180 @@
+#include "optimizer.hpp"
+
+
+List<Statement*> Optimizer::optimize(const List<Statement*>& statements){
+    std::vector<Statement*> kept;
+    for (Statement* statement : statements) {
+        Statement* optimized = stmt(statement);
+        if (optimized != nullptr) kept.push_back(optimized);
+        // nothing after it runs
+        if (statement->kind == StmtKind::RETURN) break;
+    }
+
+    if (kept.size() == statements.size()) {
+        for (size_t i = 0; i < kept.size(); i++) statements[i] = kept[i];
+        return statements;
+    }
+    return List<Statement*>(arena, kept);
+}
+
+Statement* Optimizer::stmt(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT: {
+            PrintStmt* print = static_cast<PrintStmt*>(stmt);
+            print->expression = expr(print->expression);
+            return print;
+        }
+        case StmtKind::EXPR: {
+            ExprStmt* exprStmt = static_cast<ExprStmt*>(stmt);
+            exprStmt->expression = expr(exprStmt->expression);
+            if (exprStmt->expression->kind == ExprKind::LITERAL) return nullptr;
+            return exprStmt;
+        }
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            if (var->initializer != nullptr) var->initializer = expr(var->initializer);
+            return var;
+        }
+        case StmtKind::BLOCK: {
+            BlockStmt* block = static_cast<BlockStmt*>(stmt);
+            block->statements = optimize(block->statements);
+            return block;
+        }
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            ifStmt->condition = expr(ifStmt->condition);
+            if (ifStmt->condition->kind == ExprKind::LITERAL) {
+                Statement* taken = isTruthy(static_cast<Literal*>(ifStmt->condition)->value)
+                    ? ifStmt->thenBranch : ifStmt->elseBranch;
+                return taken != nullptr ? this->stmt(taken) : nullptr;
+            }
+            ifStmt->thenBranch = body(ifStmt->thenBranch);
+            if (ifStmt->elseBranch != nullptr) ifStmt->elseBranch = this->stmt(ifStmt->elseBranch);
+            return ifStmt;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            whileStmt->condition = expr(whileStmt->condition);
+            if (whileStmt->condition->kind == ExprKind::LITERAL
+                && !isTruthy(static_cast<Literal*>(whileStmt->condition)->value))
+                return nullptr;
+            whileStmt->body = body(whileStmt->body);
+            return whileStmt;
+        }
+        case StmtKind::FUNCTION: {
+            // a pre-parsed body is optimized when it is compiled
+            FunctionStmt* function = static_cast<FunctionStmt*>(stmt);
+            if (function->lazy == nullptr) function->body = optimize(function->body);
+            return function;
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            if (returnStmt->value != nullptr) returnStmt->value = expr(returnStmt->value);
+            return returnStmt;
+        }
+        case StmtKind::IMPORT:
+            return stmt;
+    }
+    return stmt;
+}
+
+Statement* Optimizer::body(Statement* stmt){
+    Statement* optimized = this->stmt(stmt);
+    if (optimized != nullptr) return optimized;
+    return new (arena) BlockStmt(List<Statement*>());
+}
+
+Expr* Optimizer::expr(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY: return binary(static_cast<Binary*>(expr));
+        case ExprKind::GROUPING: return this->expr(static_cast<Grouping*>(expr)->expression);
+        case ExprKind::LITERAL: return expr;
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            call->callee = this->expr(call->callee);
+            for (Expr*& argument : call->arguments) argument = this->expr(argument);
+            return call;
+        }
+        case ExprKind::UNARY: return unary(static_cast<Unary*>(expr));
+        case ExprKind::VARIABLE: return expr;
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            assign->value = this->expr(assign->value);
+            return assign;
+        }
+        case ExprKind::LOGICAL: return logical(static_cast<Logical*>(expr));
+        case ExprKind::INLINE: return expr;
+    }
+    return expr;
+}
+
+// Only the combinations Interpreter::visitBinary accepts; anything else
+// raises its error at runtime.
+Expr* Optimizer::binary(Binary* binary){
+    binary->left = expr(binary->left);
+    binary->right = expr(binary->right);
+    if (binary->left->kind != ExprKind::LITERAL || binary->right->kind != ExprKind::LITERAL) return binary;
+
+    Value left = static_cast<Literal*>(binary->left)->value;
+    Value right = static_cast<Literal*>(binary->right)->value;
+    Value value = Value::undefined();
+    if (left.type() == ValueType::NUMBER && right.type() == ValueType::NUMBER) {
+        double a = left.number(), b = right.number();
+        switch (binary->oper.type) {
+            case TokenType::GREATER: value = constants.boolean(a > b); break;
+            case TokenType::GREATER_EQUAL: value = constants.boolean(a >= b); break;
+            case TokenType::LESS: value = constants.boolean(a < b); break;
+            case TokenType::LESS_EQUAL: value = constants.boolean(a <= b); break;
+            case TokenType::MINUS: value = constants.number(a - b); break;
+            case TokenType::SLASH: value = constants.number(a / b); break;
+            case TokenType::STAR: value = constants.number(a * b); break;
+            case TokenType::PLUS: value = constants.number(a + b); break;
+            case TokenType::BANG_EQUAL: value = constants.boolean(a != b); break;
+            case TokenType::EQUAL_EQUAL: value = constants.boolean(a == b); break;
+            default: break;
+        }
+    } else if (left.type() == ValueType::STRING && right.type() == ValueType::STRING) {
+        switch (binary->oper.type) {
+            case TokenType::PLUS: value = constants.string(left.str() + right.str()); break;
+            case TokenType::BANG_EQUAL: value = constants.boolean(left.str() != right.str()); break;
+            case TokenType::EQUAL_EQUAL: value = constants.boolean(left.str() == right.str()); break;
+            default: break;
+        }
+    }
+    if (!value.defined()) return binary;
+    return new (arena) Literal(value);
+}
+
+Expr* Optimizer::unary(Unary* unary){
+    unary->right = expr(unary->right);
+    if (unary->right->kind != ExprKind::LITERAL) return unary;
+
+    Value right = static_cast<Literal*>(unary->right)->value;
+    switch (unary->oper.type) {
+        case TokenType::MINUS:
+            if (right.type() != ValueType::NUMBER) return unary;
+            return new (arena) Literal(constants.number(-right.number()));
+        case TokenType::BANG:
+            return new (arena) Literal(constants.boolean(!isTruthy(right)));
+        default:
+            return unary;
+    }
+}
+
+// `and` and `or` give back one of their operands, so a literal left side
+// decides which.
+Expr* Optimizer::logical(Logical* logical){
+    logical->left = expr(logical->left);
+    logical->right = expr(logical->right);
+    if (logical->left->kind != ExprKind::LITERAL) return logical;
+
+    bool truthy = isTruthy(static_cast<Literal*>(logical->left)->value);
+    if (logical->oper.type == TokenType::OR) return truthy ? logical->left : logical->right;
+    return truthy ? logical->right : logical->left;
+}
+
+bool Optimizer::isTruthy(Value value){
+    if (value.type() == ValueType::NIL) return false;
+    if (value.type() == ValueType::BOOLEAN) return value.boolean();
+    return true;
+}
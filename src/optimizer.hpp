@@ -0,0 +1,39 @@
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+
+#include <vector>
+
+#include "types.hpp"
+#include "unit.hpp"
+
+// Rewrites a resolved tree before it runs: folds operators whose operands are
+// literals, takes the branch of an `if`, `and` or `or` whose condition is a
+// literal, and drops loops that never run, expression statements that are just
+// a literal, and statements after a `return`. An operation that would fail at
+// runtime is left alone, so the error is still raised where it was.
+//
+// New nodes go in the unit's arena and new literals in its constant pool.
+class Optimizer {
+public:
+    explicit Optimizer(CompilationUnit& unit) : arena(unit.arena), constants(unit.constants) {}
+
+    // the statements to run instead, which may share nodes with these
+    List<Statement*> optimize(const List<Statement*>& statements);
+
+private:
+    Arena& arena;
+    ConstantPool& constants;
+
+    // nullptr when nothing is left of it
+    Statement* stmt(Statement* stmt);
+    // never nullptr, where an `if` or `while` needs a statement
+    Statement* body(Statement* stmt);
+    Expr* expr(Expr* expr);
+    Expr* binary(Binary* binary);
+    Expr* unary(Unary* unary);
+    Expr* logical(Logical* logical);
+
+    static bool isTruthy(Value value);
+};
+
+#endif //OPTIMIZER_H_
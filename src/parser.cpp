@@ -1,34 +1,41 @@
 // #include "types.hpp"
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
 
 #include "parser.hpp"
 
-std::vector<Statement*> Parser::parse(){
+List<Statement*> Parser::parse(){
     std::vector<Statement*> statements;
     while(!isAtEnd()){
         statements.push_back(declaration());
     }
-    return statements;
+    return List<Statement*>(*arena, statements);
+}
+
+List<Statement*> Parser::parseBody(){
+    consume(TokenType::LEFT_BRACE, "Expect '{' before function body.");
+    return static_cast<BlockStmt*>(block())->statements;
 }
 Statement* Parser::declaration(){
     try {
         if (match(TokenType::VAR)) return varDeclaration();
         if (match(TokenType::FUN)) return funDeclaration("function ");
+        if (match(TokenType::IMPORT)) return importDeclaration();
         return statement();
 
     }catch(ParseError error){
         synchronize();
-        return new ExprStmt(new Literal( "nil", TokenType::NIL));
+        return new (*arena) ExprStmt(new (*arena) Literal(constants.nil()));
     }
 }
 
 
 Statement* Parser::funDeclaration(std::string kind){
-    Token name = consume(TokenType::IDENTIFIER, "Expect " + kind + " name.");
+    Name name = consume(TokenType::IDENTIFIER, "Expect " + kind + " name.");
 
     consume(TokenType::LEFT_PAREN, "Expect '(' after " + kind + " name.");
-    std::vector<Token> parameters;
+    std::vector<Name> parameters;
     if (!check(TokenType::RIGHT_PAREN)) {
         do {
             if (parameters.size() >= 255) {
@@ -39,13 +46,44 @@ Statement* Parser::funDeclaration(std::string kind){
     }
     consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
 
-    consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body.");
-    std::vector<Statement*> body = dynamic_cast<BlockStmt*>(block())->statements;
-    return new FunctionStmt(name, parameters, body);
+    const Token& brace = consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body.");
+    if (lazy && !preparsing) {
+        LazyBody* body = &unit.lazyBodies.emplace_back();
+        body->offset = brace.start - unit.source->text().data();
+        body->line = brace.line;
+        preparseBlock(*body);
+        return new (*arena) FunctionStmt(name, List<Name>(*arena, parameters), List<Statement*>(), &unit, body);
+    }
+    List<Statement*> body = static_cast<BlockStmt*>(block())->statements;
+    return new (*arena) FunctionStmt(name, List<Name>(*arena, parameters), body, &unit);
+}
+
+// Parses a block only to report its syntax errors, collect the names it uses
+// and see whether it is just a `return`. Functions nested in it are parsed eagerly; they are pre-parsed again
+// when the block is compiled.
+void Parser::preparseBlock(LazyBody& body){
+    arena = &scratch;
+    preparsing = true;
+    names = &body.names;
+    try {
+        List<Statement*> statements = static_cast<BlockStmt*>(block())->statements;
+        body.expression = statements.size() == 1 && statements[0]->kind == StmtKind::RETURN
+            && static_cast<ReturnStmt*>(statements[0])->value != nullptr;
+    } catch (...) {
+        arena = &unit.arena;
+        preparsing = false;
+        scratch.reset();
+        throw;
+    }
+    arena = &unit.arena;
+    preparsing = false;
+    scratch.reset();
+    std::sort(body.names.begin(), body.names.end());
+    body.names.erase(std::unique(body.names.begin(), body.names.end()), body.names.end());
 }
 
 Statement* Parser::varDeclaration(){
-    Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
+    Name name = consume(TokenType::IDENTIFIER, "Expect variable name.");
 
     Expr* initializer = nullptr;
 
@@ -53,7 +91,14 @@ Statement* Parser::varDeclaration(){
         initializer = expression();
     }
     consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-    return new VarStmt(name, initializer);
+    return new (*arena) VarStmt(name, initializer);
+}
+
+Statement* Parser::importDeclaration(){
+    Token keyword = previous();
+    Token path = consume(TokenType::STRING, "Expect module path after 'import'.");
+    consume(TokenType::SEMICOLON, "Expect ';' after module path.");
+    return new (*arena) ImportStmt(keyword, path, &unit);
 }
 
 Statement* Parser::statement(){
@@ -74,7 +119,7 @@ Statement* Parser::returnStatement() {
         value = expression();
     }
     consume(TokenType::SEMICOLON, "Expect ';' after return value.");
-    return new ReturnStmt(keyword, value);
+    return new (*arena) ReturnStmt(keyword, value);
 }
 
 Statement* Parser::ifStatement() {
@@ -86,7 +131,7 @@ Statement* Parser::ifStatement() {
     if (match(TokenType::ELSE)) 
         elseBranch = statement();
     
-    return new IfStmt(condition, thenBranch, elseBranch);
+    return new (*arena) IfStmt(condition, thenBranch, elseBranch);
 }
 
 Statement* Parser::forStatement() {
@@ -118,15 +163,15 @@ Statement* Parser::forStatement() {
     Statement* body = statement();
 
     if (increment != nullptr) {
-        Statement* expr = new ExprStmt(increment);
+        Statement* expr = new (*arena) ExprStmt(increment);
         std::vector< Statement*> statements = {body, expr};
-        body = new BlockStmt(statements);
+        body = new (*arena) BlockStmt(List<Statement*>(*arena, statements));
     }
 
-    body = new WhileStmt(condition, body);
+    body = new (*arena) WhileStmt(condition, body);
     if (initializer != nullptr){
         std::vector<Statement* > statements = {initializer, body}; 
-        body = new BlockStmt(statements); 
+        body = new (*arena) BlockStmt(List<Statement*>(*arena, statements)); 
     }
     
     return body;
@@ -137,13 +182,13 @@ Statement* Parser::whileStatement() {
     Expr* condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
     Statement* body = statement();
-    return new WhileStmt(condition, body);
+    return new (*arena) WhileStmt(condition, body);
 }
 
 Statement* Parser::printStatement(){
     Expr* value = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after value. ");
-    return new PrintStmt(value);
+    return new (*arena) PrintStmt(value);
 }
 
 Statement* Parser::block(){
@@ -153,14 +198,14 @@ Statement* Parser::block(){
         statements.push_back(declaration());
     }
     consume(TokenType::RIGHT_BRACE, "Expect '}' after block.");
-    return new BlockStmt(statements);
+    return new (*arena) BlockStmt(List<Statement*>(*arena, statements));
     
 }
 
 Statement* Parser::expressionStatement(){
     Expr* value = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after value. ");
-    return new ExprStmt(value);
+    return new (*arena) ExprStmt(value);
 }
 
 Expr* Parser::expression() {
@@ -175,8 +220,8 @@ Expr* Parser::assignment(){
         Expr* value = assignment();
 
         if (dynamic_cast<const Variable*>(expr) != nullptr){
-            Token name = dynamic_cast<Variable*>(expr)->name; 
-            return new Assign(name, value);
+            Name name = dynamic_cast<Variable*>(expr)->name; 
+            return new (*arena) Assign(name, value);
         }
 
     error(equals, "Invalid assignment target"); 
@@ -189,7 +234,7 @@ Expr* Parser::or_(){
     while (match(TokenType::OR)) {
         Token oper = previous();
         Expr* right = and_();
-        expr = new Logical(expr, oper, right);
+        expr = new (*arena) Logical(expr, oper, right);
     }
     return expr; 
 }
@@ -200,7 +245,7 @@ Expr* Parser::and_(){
     while (match(TokenType::AND)) {
         Token oper = previous();
         Expr* right = equality();
-        expr = new Logical(expr, oper, right);
+        expr = new (*arena) Logical(expr, oper, right);
     }
     return expr;
 }
@@ -213,7 +258,7 @@ Expr* Parser::equality(){
     while (match(exprs) ) {
         Token oper = previous();
         Expr* right = comparison();
-        expr = new Binary(expr, oper, right);   
+        expr = new (*arena) Binary(expr, oper, right);   
     }
 
     return expr;
@@ -226,7 +271,7 @@ Expr* Parser::comparison(){
     while (match(exprs)){
         Token oper = previous();
         Expr* right = term();
-        expr = new Binary(expr, oper, right);   
+        expr = new (*arena) Binary(expr, oper, right);   
     }
 
     return expr;
@@ -239,7 +284,7 @@ Expr* Parser::term(){
     while (match(exprs)){
         Token oper = previous();
         Expr* right = factor();
-        expr = new Binary(expr, oper, right);   
+        expr = new (*arena) Binary(expr, oper, right);   
     }
 
     return expr;
@@ -252,7 +297,7 @@ Expr* Parser::factor(){
     while (match(exprs)){
         Token oper = previous();
         Expr* right = unary();
-        expr = new Binary(expr, oper, right);   
+        expr = new (*arena) Binary(expr, oper, right);   
     }
 
     return expr;
@@ -263,7 +308,7 @@ Expr* Parser::unary(){
     if (match(exprs)){
         Token oper = previous();
         Expr* right = unary();
-        return new Unary(oper, right);   
+        return new (*arena) Unary(oper, right);   
     }
 
     return call();
@@ -284,20 +329,22 @@ Expr* Parser::call(){
 }
 
 Expr* Parser::primary(){
-    if (match(TokenType::FALSE)) return new Literal("false", TokenType::FALSE);
-    if (match(TokenType::TRUE)) return new Literal("true", TokenType::TRUE);
-    if (match(TokenType::NIL)) return new Literal("nil", TokenType::NIL);
-    if (match(TokenType::IDENTIFIER)) return new Variable(previous());
+    if (match(TokenType::IDENTIFIER)) {
+        Variable* variable = new (*arena) Variable(previous());
+        if (preparsing) names->push_back(variable->name.symbol);
+        return variable;
+    }
 
-    std::vector<TokenType> exprs = {TokenType::NUMBER, TokenType::STRING};
+    std::vector<TokenType> exprs = {TokenType::FALSE, TokenType::TRUE, TokenType::NIL, TokenType::NUMBER, TokenType::STRING};
     if (match(exprs)){
-        return new Literal(previous().literal, previous().type);
+        // values of literals in pre-parsed code aren't needed yet
+        return new (*arena) Literal(preparsing ? constants.nil() : constants.literal(previous()));
     }
 
     if (match(TokenType::LEFT_PAREN)) {
         Expr* expr = expression();
         consume(TokenType::RIGHT_PAREN, "Expect ')' after expression ");
-        return new Grouping(expr);
+        return new (*arena) Grouping(expr);
     }
 
     throw error(peek(), "Expect expression.");
@@ -313,19 +360,19 @@ Expr* Parser::finishCall(Expr* callee){
         } while (match(TokenType::COMMA));
     }
     Token paren = consume(TokenType::RIGHT_PAREN, "Expect ')' after arguments.");
-    return new Call(callee, dynamic_cast<Variable*>(callee)->name, arguments);
+    return new (*arena) Call(callee, paren, List<Expr*>(*arena, arguments));
 }
 
 bool Parser::isAtEnd() { 
     return peek().type == TokenType::EOF_;
 }
 
-Token Parser::peek() {
-    return tokens[current];
+const Token& Parser::peek() {
+    return window[current % WINDOW];
 }
 
-Token Parser::previous() {
-    return tokens[current - 1];
+const Token& Parser::previous() {
+    return window[(current + WINDOW - 1) % WINDOW];
 }
 
 bool Parser::check(TokenType type) {
@@ -333,8 +380,11 @@ bool Parser::check(TokenType type) {
     return peek().type == type;
 }
 
-Token Parser::advance() {
-    if (!isAtEnd()) current++;
+const Token& Parser::advance() {
+    if (!isAtEnd()) {
+        current++;
+        window[current % WINDOW] = scanner.next();
+    }
     return previous();
 }
 
@@ -358,13 +408,13 @@ bool Parser::match(std::vector<TokenType> types) {
 }
 
 
-Token Parser::consume(TokenType type, std::string message) {
+const Token& Parser::consume(TokenType type, std::string message) {
     if (check(type)) return advance();
     throw error(peek(), message);
 }
 
 
-ParseError Parser::error(Token token, std::string message) {
+ParseError Parser::error(const Token& token, std::string message) {
     report(token.line, "", message);
     return ParseError("");
 }
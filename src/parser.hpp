@@ -4,21 +4,46 @@
 #include "types.hpp"
 #include "error.hpp"
 #include "pretty_printer.hpp"
+#include "constants.hpp"
+#include "unit.hpp"
+#include "scanner.hpp"
 
 
 class Parser {
 public:
-    std::vector<Token> tokens;
+    // Tokens are pulled from the scanner as the parser needs them and kept in
+    // a small ring, so only the last few exist at any time.
+    static const int WINDOW = 4;
+    Token window[WINDOW];
     int current  = 0;
 
-    Parser (std::vector<Token> tokens): tokens(tokens) {};
-    std::vector<Statement*> parse();
+    // Function bodies are only pre-parsed: checked for syntax into a scratch
+    // arena that is thrown away, and parsed for real on their first call.
+    bool lazy = false;
+
+    // nodes are allocated in the unit's arena
+    Parser (Scanner& scanner, ConstantPool& constants, CompilationUnit& unit)
+        : scanner(scanner), constants(constants), unit(unit), arena(&unit.arena) {
+        window[0] = scanner.next();
+    };
+    List<Statement*> parse();
+    // a function body, with the scanner positioned at its '{'
+    List<Statement*> parseBody();
 
 private:
+    Scanner& scanner;
+    ConstantPool& constants;
+    CompilationUnit& unit;
+    Arena* arena;
+    Arena scratch;
+    bool preparsing = false;
+    // where a pre-parse collects the names it sees
+    std::vector<Symbol>* names = nullptr;
 
     Statement* declaration();
     Statement* funDeclaration(std::string kind);
     Statement* varDeclaration();
+    Statement* importDeclaration();
     Statement* statement();
     Statement* returnStatement();
     Statement* ifStatement();
@@ -26,6 +51,7 @@ private:
     Statement* whileStatement();
     Statement* printStatement();
     Statement* block();
+    void preparseBlock(LazyBody& body);
     Statement* expressionStatement();
 
     Expr* expression();
@@ -42,14 +68,14 @@ private:
     Expr* finishCall(Expr* callee);
 
     bool isAtEnd() ;
-    Token peek() ;
-    Token previous() ;
+    const Token& peek() ;
+    const Token& previous() ;
     bool check(TokenType type) ;
-    Token advance() ;
+    const Token& advance() ;
     bool match(TokenType type);
     bool match(std::vector<TokenType> types) ;
-    Token consume(TokenType type, std::string message) ;
-    ParseError error(Token token, std::string message) ;
+    const Token& consume(TokenType type, std::string message) ;
+    ParseError error(const Token& token, std::string message) ;
 
     void synchronize() ;
 
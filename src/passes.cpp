@@ -0,0 +1,358 @@
+#include <iomanip>
+
+#include "passes.hpp"
+#include "optimizer.hpp"
+#include "inliner.hpp"
+#include "inference.hpp"
+#include "hoister.hpp"
+#include "purity.hpp"
+#include "memo.hpp"
+
+
+class FoldPass : public Pass {
+public:
+    const char* name() const { return "fold"; }
+    void run(Code& code) { code.statements = Optimizer(code.unit).optimize(code.statements); }
+};
+
+class InlinePass : public Pass {
+public:
+    const char* name() const { return "inline"; }
+    void run(Code& code) { Inliner(code.unit).inlineCalls(code.statements, code.locals); }
+};
+
+class TypesPass : public Pass {
+public:
+    const char* name() const { return "types"; }
+    bool transforms() const { return false; }
+    void run(Code& code) { TypeInference().infer(code.statements, code.locals); }
+};
+
+// needs types
+class LicmPass : public Pass {
+public:
+    const char* name() const { return "licm"; }
+    void run(Code& code) { Hoister(code.unit).hoist(code.statements, code.locals); }
+};
+
+// for --memoize-pure, on function bodies; after inline, whose copies it reads
+class PurityPass : public Pass {
+public:
+    const char* name() const { return "purity"; }
+    bool transforms() const { return false; }
+    void run(Code& code) { if (code.function != nullptr) Purity(code.unit).analyze(*code.function); }
+};
+
+
+PassManager::Options PassManager::options;
+std::mutex PassManager::lock;
+std::vector<PassManager::Totals> PassManager::totals;
+
+PassManager::PassManager(int level){
+    if (level >= 1) add(std::make_unique<FoldPass>());
+    if (level >= 2) add(std::make_unique<InlinePass>());
+    if (level >= 1) add(std::make_unique<TypesPass>());
+    if (level >= 2) add(std::make_unique<LicmPass>());
+    if (Memo::enabled) add(std::make_unique<PurityPass>());
+}
+
+PassManager& PassManager::pipeline(){
+    static PassManager pipeline(options.level);
+    return pipeline;
+}
+
+bool PassManager::known(const std::string& name){
+    for (const std::unique_ptr<Pass>& pass : PassManager(2).passes)
+        if (name == pass->name()) return true;
+    return name == PurityPass().name();
+}
+
+void PassManager::add(std::unique_ptr<Pass> pass){
+    passes.push_back(std::move(pass));
+}
+
+void PassManager::run(Code& code){
+    for (const std::unique_ptr<Pass>& pass : passes) {
+        if (!options.timePasses) {
+            pass->run(code);
+        } else {
+            size_t before = count(code.statements);
+            auto start = std::chrono::steady_clock::now();
+            pass->run(code);
+            auto time = std::chrono::steady_clock::now() - start;
+            size_t after = count(code.statements);
+
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = totals.begin();
+            while (it != totals.end() && it->name != pass->name()) ++it;
+            if (it == totals.end()) it = totals.insert(it, Totals{pass->name(), pass->transforms()});
+            it->runs++;
+            it->time += time;
+            it->nodesBefore += before;
+            it->nodesAfter += after;
+        }
+
+        if (options.dumpAfter == pass->name()) {
+            std::lock_guard<std::mutex> guard(lock);
+            dump(code, pass->name(), std::cerr);
+        }
+    }
+}
+
+void PassManager::report(std::ostream& out){
+    std::lock_guard<std::mutex> guard(lock);
+    out << "pass      kind         runs    time (ms)   nodes before    nodes after\n";
+    std::chrono::steady_clock::duration total{};
+    for (const Totals& pass : totals) {
+        total += pass.time;
+        out << std::left << std::setw(10) << pass.name << std::setw(10) << (pass.transforms ? "transform" : "analysis")
+            << std::right << std::setw(7) << pass.runs
+            << std::setw(13) << std::fixed << std::setprecision(3)
+            << std::chrono::duration<double, std::milli>(pass.time).count()
+            << std::setw(15) << pass.nodesBefore << std::setw(15) << pass.nodesAfter << "\n";
+    }
+    out << std::left << std::setw(27) << "total" << std::right << std::setw(13)
+        << std::chrono::duration<double, std::milli>(total).count() << "\n";
+    out << std::defaultfloat;
+}
+
+// Nodes of the code itself: a nested function counts as one, as its body is
+// counted when it is compiled.
+size_t PassManager::count(const List<Statement*>& statements){
+    size_t nodes = 0;
+    for (Statement* statement : statements) nodes += count(statement);
+    return nodes;
+}
+
+size_t PassManager::count(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT: return 1 + count(static_cast<PrintStmt*>(stmt)->expression);
+        case StmtKind::EXPR: return 1 + count(static_cast<ExprStmt*>(stmt)->expression);
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            return 1 + (var->initializer != nullptr ? count(var->initializer) : 0);
+        }
+        case StmtKind::BLOCK: return 1 + count(static_cast<BlockStmt*>(stmt)->statements);
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            return 1 + count(ifStmt->condition) + count(ifStmt->thenBranch)
+                + (ifStmt->elseBranch != nullptr ? count(ifStmt->elseBranch) : 0);
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            return 1 + count(whileStmt->condition) + count(whileStmt->body);
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            return 1 + (returnStmt->value != nullptr ? count(returnStmt->value) : 0);
+        }
+        case StmtKind::FUNCTION:
+        case StmtKind::IMPORT:
+            return 1;
+    }
+    return 1;
+}
+
+size_t PassManager::count(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY: return 1 + count(static_cast<Binary*>(expr)->left) + count(static_cast<Binary*>(expr)->right);
+        case ExprKind::GROUPING: return 1 + count(static_cast<Grouping*>(expr)->expression);
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            size_t nodes = 1 + count(call->callee);
+            for (Expr* argument : call->arguments) nodes += count(argument);
+            return nodes;
+        }
+        case ExprKind::UNARY: return 1 + count(static_cast<Unary*>(expr)->right);
+        case ExprKind::ASSIGN: return 1 + count(static_cast<Assign*>(expr)->value);
+        case ExprKind::LOGICAL: return 1 + count(static_cast<Logical*>(expr)->left) + count(static_cast<Logical*>(expr)->right);
+        // the call it may fall back to isn't counted
+        case ExprKind::INLINE: {
+            Inline* inlined = static_cast<Inline*>(expr);
+            size_t nodes = 1 + count(inlined->call->callee) + count(inlined->body);
+            for (Expr* argument : inlined->call->arguments) nodes += count(argument);
+            return nodes;
+        }
+        case ExprKind::LITERAL:
+        case ExprKind::VARIABLE:
+            return 1;
+    }
+    return 1;
+}
+
+// One statement a line, expressions in prefix form. Names carry where they
+// live: @L3 is slot 3 of the frame, @C3 the cell in it, @U3 the third upvalue
+// and @G3 a global. An operation TypeInference proved numeric is marked with #.
+// A function the purity pass found pure lists the functions it calls.
+void PassManager::dump(const Code& code, const char* pass, std::ostream& out){
+    out << "== after " << pass << ": ";
+    if (code.function != nullptr) out << "<fn " << code.function->name.lexeme() << ">";
+    else out << (code.unit.path.empty() ? "<repl>" : code.unit.path);
+    out << ", " << code.locals << " slots";
+    if (code.function != nullptr && code.function->pure) {
+        out << ", pure";
+        for (FunctionStmt* callee : code.function->callees) out << (callee == code.function->callees[0] ? ", calls " : " ") << callee->name.lexeme();
+    }
+    out << " ==\n";
+    for (Statement* statement : code.statements) dump(statement, 0, out);
+}
+
+void PassManager::dump(Statement* stmt, int depth, std::ostream& out){
+    out << std::string(depth * 2, ' ');
+    switch (stmt->kind) {
+        case StmtKind::PRINT:
+            out << "print ";
+            dump(static_cast<PrintStmt*>(stmt)->expression, out);
+            out << "\n";
+            break;
+        case StmtKind::EXPR:
+            dump(static_cast<ExprStmt*>(stmt)->expression, out);
+            out << "\n";
+            break;
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            out << "var ";
+            dump(var->name, var->access, var->slot, out);
+            if (var->initializer != nullptr) {
+                out << " = ";
+                dump(var->initializer, out);
+            }
+            out << "\n";
+            break;
+        }
+        case StmtKind::BLOCK:
+            out << "block\n";
+            for (Statement* statement : static_cast<BlockStmt*>(stmt)->statements) dump(statement, depth + 1, out);
+            break;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            out << "if ";
+            dump(ifStmt->condition, out);
+            out << "\n";
+            dump(ifStmt->thenBranch, depth + 1, out);
+            if (ifStmt->elseBranch != nullptr) {
+                out << std::string(depth * 2, ' ') << "else\n";
+                dump(ifStmt->elseBranch, depth + 1, out);
+            }
+            break;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            out << "while ";
+            dump(whileStmt->condition, out);
+            out << "\n";
+            dump(whileStmt->body, depth + 1, out);
+            break;
+        }
+        case StmtKind::FUNCTION: {
+            FunctionStmt* function = static_cast<FunctionStmt*>(stmt);
+            out << "fun ";
+            dump(function->name, function->access, function->slot, out);
+            out << "(";
+            for (size_t i = 0; i < function->params.size(); i++)
+                out << (i > 0 ? ", " : "") << function->params[i].lexeme();
+            out << ")" << (function->lazy != nullptr ? " <not compiled>" : "") << "\n";
+            break;
+        }
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            out << (returnStmt->tailCall ? "return tail " : "return");
+            if (returnStmt->value != nullptr) {
+                if (!returnStmt->tailCall) out << " ";
+                dump(returnStmt->value, out);
+            }
+            out << "\n";
+            break;
+        }
+        case StmtKind::IMPORT:
+            out << "import " << static_cast<ImportStmt*>(stmt)->path.lexeme() << "\n";
+            break;
+    }
+}
+
+void PassManager::dump(Expr* expr, std::ostream& out){
+    switch (expr->kind) {
+        case ExprKind::BINARY: {
+            Binary* binary = static_cast<Binary*>(expr);
+            out << "(" << binary->oper.lexeme() << (binary->numeric ? "# " : " ");
+            dump(binary->left, out);
+            out << " ";
+            dump(binary->right, out);
+            out << ")";
+            break;
+        }
+        case ExprKind::GROUPING:
+            out << "(group ";
+            dump(static_cast<Grouping*>(expr)->expression, out);
+            out << ")";
+            break;
+        case ExprKind::LITERAL: {
+            Value value = static_cast<Literal*>(expr)->value;
+            if (value.type() == ValueType::STRING) out << "\"" << value.str() << "\"";
+            else if (value.type() == ValueType::NIL) out << "nil";
+            else if (value.type() == ValueType::BOOLEAN) out << (value.boolean() ? "true" : "false");
+            else out << value.view();
+            break;
+        }
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            out << "(call ";
+            dump(call->callee, out);
+            for (Expr* argument : call->arguments) {
+                out << " ";
+                dump(argument, out);
+            }
+            out << ")";
+            break;
+        }
+        case ExprKind::UNARY: {
+            Unary* unary = static_cast<Unary*>(expr);
+            out << "(" << unary->oper.lexeme() << " ";
+            dump(unary->right, out);
+            out << ")";
+            break;
+        }
+        case ExprKind::VARIABLE: {
+            Variable* variable = static_cast<Variable*>(expr);
+            dump(variable->name, variable->access, variable->slot, out);
+            break;
+        }
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            out << "(= ";
+            dump(assign->name, assign->access, assign->slot, out);
+            out << " ";
+            dump(assign->value, out);
+            out << ")";
+            break;
+        }
+        case ExprKind::LOGICAL: {
+            Logical* logical = static_cast<Logical*>(expr);
+            out << "(" << logical->oper.lexeme() << " ";
+            dump(logical->left, out);
+            out << " ";
+            dump(logical->right, out);
+            out << ")";
+            break;
+        }
+        // the parameters are bound from slot `base` on
+        case ExprKind::INLINE: {
+            Inline* inlined = static_cast<Inline*>(expr);
+            out << "(inline " << inlined->function->name.lexeme() << "@L" << inlined->base << " ";
+            dump(inlined->call->callee, out);
+            for (Expr* argument : inlined->call->arguments) {
+                out << " ";
+                dump(argument, out);
+            }
+            out << " => ";
+            dump(inlined->body, out);
+            out << ")";
+            break;
+        }
+    }
+}
+
+void PassManager::dump(const Name& name, Access access, int slot, std::ostream& out){
+    static const char where[] = {'L', 'C', 'U', 'G'};
+    out << name.lexeme() << "@" << where[static_cast<int>(access)] << slot;
+}
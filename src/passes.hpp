@@ -0,0 +1,99 @@
+#ifndef PASSES_H_
+#define PASSES_H_
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+#include "unit.hpp"
+
+// What a pass works on: the top-level code of a unit, or a function body when
+// it is compiled. Passes may replace the statements and grow the frame.
+struct Code {
+    CompilationUnit& unit;
+    List<Statement*>& statements;
+    uint32_t& locals;
+    // the function, or null for top-level code
+    FunctionStmt* function;
+};
+
+// One step of the pipeline between resolution and running. A transform
+// rewrites the tree; an analysis only annotates it for later passes and the
+// interpreter.
+class Pass {
+public:
+    virtual ~Pass() = default;
+
+    // what --dump-after and --time-passes call it
+    virtual const char* name() const = 0;
+    virtual bool transforms() const { return true; }
+    virtual void run(Code& code) = 0;
+};
+
+// Runs the passes of an optimization level, in order, on every piece of code
+// compiled, which can be on several threads at once while modules load.
+//
+//   -O0  nothing; every operation is checked as it runs
+//   -O1  fold, types
+//   -O2  fold, inline, types, licm (the default)
+//
+// and at any of them purity last, with --memoize-pure.
+//
+// With --time-passes it adds up the wall time of each pass and the nodes in
+// the code before and after it, for report(). With --dump-after=<pass> it
+// prints the code each time that pass has run on it.
+class PassManager {
+public:
+    struct Options {
+        int level = 2;
+        bool timePasses = false;
+        // a pass name, or empty
+        std::string dumpAfter;
+    };
+    // from the command line, set before anything is compiled
+    static Options options;
+
+    explicit PassManager(int level);
+
+    // the pipeline of options.level
+    static PassManager& pipeline();
+    // whether some level has a pass called that
+    static bool known(const std::string& name);
+
+    void add(std::unique_ptr<Pass> pass);
+    void run(Code& code);
+
+    // the --time-passes table
+    static void report(std::ostream& out);
+
+private:
+    struct Totals {
+        std::string name;
+        bool transforms;
+        size_t runs = 0;
+        std::chrono::steady_clock::duration time{};
+        size_t nodesBefore = 0;
+        size_t nodesAfter = 0;
+    };
+
+    std::vector<std::unique_ptr<Pass>> passes;
+
+    static std::mutex lock;
+    // in the order the passes first ran
+    static std::vector<Totals> totals;
+
+    static size_t count(const List<Statement*>& statements);
+    static size_t count(Statement* stmt);
+    static size_t count(Expr* expr);
+
+    static void dump(const Code& code, const char* pass, std::ostream& out);
+    static void dump(Statement* stmt, int depth, std::ostream& out);
+    static void dump(Expr* expr, std::ostream& out);
+    static void dump(const Name& name, Access access, int slot, std::ostream& out);
+};
+
+#endif //PASSES_H_
@@ -6,7 +6,7 @@
 class PrettyPrinter: public ExprVisitor {
 
 private: 
-    Value* parenthesize(std::string name, std::vector<Expr*> exprs, ExprVisitor& visitor)  { 
+    Value parenthesize(std::string name, std::vector<Expr*> exprs, ExprVisitor& visitor)  { 
 
         std::ostringstream oss;
         oss << "(" << name;
@@ -19,41 +19,41 @@ private:
         
         oss  << ")";
 
-        return new Value(oss.str());
+        return Value(oss.str());
 
     }
 public:
-    Value* visitBinary(Binary& expr) {
-    std::vector<Expr*> exprs = {&expr.left, &expr.right}; 
-      return parenthesize(expr.oper.lexeme, exprs, *this);
+    Value visitBinary(Binary& expr) {
+    std::vector<Expr*> exprs = {expr.left, expr.right}; 
+      return parenthesize(std::string(expr.oper.lexeme()), exprs, *this);
     }
 
-    Value* visitGrouping(Grouping& expr) {
-        std::vector<Expr*> exprs = {&expr.expression}; 
+    Value visitGrouping(Grouping& expr) {
+        std::vector<Expr*> exprs = {expr.expression}; 
         return parenthesize("group", exprs, *this);
     }
 
-    Value* visitLiteral(Literal& expr) {
-        std::cout << expr.value ;
-        return new Value(expr.value);
+    Value visitLiteral(Literal& expr) {
+        std::cout << expr.value.view() ;
+        return expr.value;
     }
 
-    Value* visitUnary(Unary& expr) {
-        std::vector<Expr*> exprs = {&expr.right};
-        return parenthesize(expr.oper.lexeme, exprs, *this);
+    Value visitUnary(Unary& expr) {
+        std::vector<Expr*> exprs = {expr.right};
+        return parenthesize(std::string(expr.oper.lexeme()), exprs, *this);
     }
 
     
-    Value* visitVariable(Variable& expr) {
-        return new Value(expr.name.lexeme);
+    Value visitVariable(Variable& expr) {
+        return Value(std::string(expr.name.lexeme()));
     };
 
-     Value* visitAssign(Assign& expr) {
-        return new Value(expr.name.lexeme + " = " + expr.value->accept(*this)->view() );
+     Value visitAssign(Assign& expr) {
+        return Value(std::string(expr.name.lexeme()) + " = " + expr.value->accept(*this).view() );
     };
 
-    virtual Value* visitLogicalExpr(Logical& expr) {
-      return new Value( expr.left->accept(*this)->view() + " " + expr.oper.lexeme + " " + expr.right->accept(*this)->view() );  
+    virtual Value visitLogicalExpr(Logical& expr) {
+      return Value( expr.left->accept(*this).view() + " " + std::string(expr.oper.lexeme()) + " " + expr.right->accept(*this).view() );  
     };
 };
 
@@ -0,0 +1,133 @@
+#include <algorithm>
+
+#include "purity.hpp"
+
+
+void Purity::analyze(FunctionStmt& function){
+    pure = true;
+    callees.clear();
+    functionSlots.clear();
+    for (Statement* statement : function.body) stmt(statement);
+
+    function.pure = pure;
+    function.callees = List<FunctionStmt*>(arena, callees);
+}
+
+void Purity::stmt(Statement* stmt){
+    switch (stmt->kind) {
+        case StmtKind::PRINT:
+        case StmtKind::IMPORT:
+            pure = false;
+            break;
+        case StmtKind::EXPR:
+            expr(static_cast<ExprStmt*>(stmt)->expression);
+            break;
+        case StmtKind::VAR: {
+            VarStmt* var = static_cast<VarStmt*>(stmt);
+            if (var->initializer != nullptr) expr(var->initializer);
+            break;
+        }
+        case StmtKind::BLOCK:
+            for (Statement* statement : static_cast<BlockStmt*>(stmt)->statements) this->stmt(statement);
+            break;
+        case StmtKind::IF: {
+            IfStmt* ifStmt = static_cast<IfStmt*>(stmt);
+            expr(ifStmt->condition);
+            this->stmt(ifStmt->thenBranch);
+            if (ifStmt->elseBranch != nullptr) this->stmt(ifStmt->elseBranch);
+            break;
+        }
+        case StmtKind::WHILE: {
+            WhileStmt* whileStmt = static_cast<WhileStmt*>(stmt);
+            expr(whileStmt->condition);
+            this->stmt(whileStmt->body);
+            break;
+        }
+        // its body is looked at if it is called
+        case StmtKind::FUNCTION:
+            functionSlots.insert(static_cast<FunctionStmt*>(stmt)->slot);
+            break;
+        case StmtKind::RETURN: {
+            ReturnStmt* returnStmt = static_cast<ReturnStmt*>(stmt);
+            if (returnStmt->value != nullptr) expr(returnStmt->value);
+            break;
+        }
+    }
+}
+
+void Purity::expr(Expr* expr){
+    switch (expr->kind) {
+        case ExprKind::BINARY:
+            this->expr(static_cast<Binary*>(expr)->left);
+            this->expr(static_cast<Binary*>(expr)->right);
+            break;
+        case ExprKind::GROUPING:
+            this->expr(static_cast<Grouping*>(expr)->expression);
+            break;
+        case ExprKind::LITERAL:
+            break;
+        case ExprKind::CALL: {
+            Call* call = static_cast<Call*>(expr);
+            this->call(call->callee, call->target);
+            for (Expr* argument : call->arguments) this->expr(argument);
+            break;
+        }
+        case ExprKind::UNARY:
+            this->expr(static_cast<Unary*>(expr)->right);
+            break;
+        case ExprKind::VARIABLE: {
+            Access access = static_cast<Variable*>(expr)->access;
+            if (access == Access::UPVALUE || access == Access::GLOBAL) pure = false;
+            break;
+        }
+        case ExprKind::ASSIGN: {
+            Assign* assign = static_cast<Assign*>(expr);
+            if (assign->access == Access::UPVALUE || assign->access == Access::GLOBAL
+                || functionSlots.count(assign->slot) != 0)
+                pure = false;
+            this->expr(assign->value);
+            break;
+        }
+        case ExprKind::LOGICAL:
+            this->expr(static_cast<Logical*>(expr)->left);
+            this->expr(static_cast<Logical*>(expr)->right);
+            break;
+        // the copied body reads the upvalues of the function inlined, which is
+        // a callee, so it has to be pure anyway
+        case ExprKind::INLINE: {
+            Inline* inlined = static_cast<Inline*>(expr);
+            call(inlined->call->callee, inlined->function);
+            for (Expr* argument : inlined->call->arguments) this->expr(argument);
+            this->expr(inlined->body);
+            break;
+        }
+    }
+}
+
+void Purity::call(Expr* callee, FunctionStmt* target){
+    if (callee->kind != ExprKind::VARIABLE || target == nullptr) {
+        pure = false;
+        return;
+    }
+    if (std::find(callees.begin(), callees.end(), target) == callees.end()) callees.push_back(target);
+}
+
+// Recursion, direct or not, doesn't stop a function being pure.
+bool Purity::memoizable(FunctionStmt& function){
+    if (function.memoize != FunctionStmt::Memoize::UNKNOWN) return function.memoize == FunctionStmt::Memoize::YES;
+
+    std::vector<FunctionStmt*> reached = {&function};
+    for (size_t i = 0; i < reached.size(); i++) {
+        FunctionStmt* next = reached[i];
+        // not yet known
+        if (next->lazy != nullptr) return false;
+        if (!next->pure) {
+            function.memoize = FunctionStmt::Memoize::NO;
+            return false;
+        }
+        for (FunctionStmt* callee : next->callees)
+            if (std::find(reached.begin(), reached.end(), callee) == reached.end()) reached.push_back(callee);
+    }
+    function.memoize = FunctionStmt::Memoize::YES;
+    return true;
+}
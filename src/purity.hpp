@@ -0,0 +1,39 @@
+#ifndef PURITY_H_
+#define PURITY_H_
+
+#include <unordered_set>
+#include <vector>
+
+#include "types.hpp"
+#include "unit.hpp"
+
+// Works out whether a function body has effects of its own, for
+// --memoize-pure. It mustn't print, import, or assign a global, an upvalue or
+// a local holding one of its nested functions. It may only read its own
+// frame, except for calling a function the Resolver could tell by name,
+// which is recorded in FunctionStmt::callees. Whether those are pure in turn
+// is only known once they are compiled, see memoizable().
+class Purity {
+public:
+    explicit Purity(CompilationUnit& unit) : arena(unit.arena) {}
+
+    // sets function.pure and function.callees
+    void analyze(FunctionStmt& function);
+
+    // whether calls to `function` may be memoized, deciding it if all the
+    // functions it can reach are compiled
+    static bool memoizable(FunctionStmt& function);
+
+private:
+    Arena& arena;
+    bool pure = true;
+    std::vector<FunctionStmt*> callees;
+    // slots holding its nested functions
+    std::unordered_set<int> functionSlots;
+
+    void stmt(Statement* stmt);
+    void expr(Expr* expr);
+    void call(Expr* callee, FunctionStmt* target);
+};
+
+#endif //PURITY_H_
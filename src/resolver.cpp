@@ -4,7 +4,16 @@
 #include "resolver.hpp"
 
 
-void Resolver::resolve(std::vector<Statement*> statements){
+void Resolver::resolve(CompilationUnit& unit){
+    FunctionScope top;
+    current = &top;
+    this->unit = &unit;
+    resolve(unit.statements);
+    unit.locals = top.size;
+    current = nullptr;
+}
+
+void Resolver::resolve(const List<Statement*>& statements){
     for(Statement* statement : statements){
         resolve(statement);
     }
@@ -19,50 +28,140 @@ void Resolver::resolve(Expr* expr){
 }
 
 void Resolver::beginScope(){
-    scopes.push_back(new std::unordered_map<std::string, bool> ); 
+    current->scopes.emplace_back();
 }
 
 void Resolver::endScope(){
-    scopes.pop_back();
+    Scope& scope = current->scopes.back();
+    for (auto& [name, local] : scope.locals) {
+        if (!local.captured) continue;
+        for (Access* use : local.uses) *use = Access::CELL;
+    }
+    current->next -= scope.locals.size();
+    current->scopes.pop_back();
 }
 
-void Resolver::declare(Token name) {
- if (scopes.size() == 0) return;
-    std::unordered_map<std::string, bool>* scope = scopes[scopes.size() -1];
-    if (scope->find(name.lexeme) != scope->end()){
+// The slot `name` gets in the frame, or -1 for a global. `access` is where
+// the declaration records whether it is captured.
+int Resolver::declare(const Name& name, Access* access) {
+ if (current->scopes.size() == 0) return -1;
+    Scope& scope = current->scopes.back();
+    auto it = scope.locals.find(name.symbol);
+    if (it != scope.locals.end()){
         error(name.line, "Already variable with this name in this scope");
+        return it->second.slot;
     }
-    (*scope)[name.lexeme] = false;
+    Local& local = scope.locals[name.symbol];
+    local.slot = current->next++;
+    current->size = std::max(current->size, current->next);
+    if (access != nullptr) local.uses.push_back(access);
+    return local.slot;
  }
 
-void Resolver::define(Token name) {
- if (scopes.size() == 0) return;
-    std::unordered_map<std::string, bool>* scope = scopes[scopes.size() -1];
-    (*scope)[name.lexeme] = true;
+void Resolver::define(const Name& name) {
+ if (current->scopes.size() == 0) return;
+    current->scopes.back().locals[name.symbol].defined = true;
  }
 
 
-void Resolver::resolveLocal(Expr* expr, Token name){
-    for (int i = scopes.size() - 1; i >= 0; i--) {
-        if (scopes[i]->find(name.lexeme) != scopes[i]->end()){
-            interpreter->resolve(expr, scopes.size() - i - 1);
-            return;
+// The innermost local of the function being resolved named `name`, if any.
+Local* Resolver::local(Symbol name){
+    for (int i = current->scopes.size() - 1; i >= 0; i--) {
+        auto it = current->scopes[i].locals.find(name);
+        if (it != current->scopes[i].locals.end()) return &it->second;
+    }
+    return nullptr;
+}
+
+// A local of the function being resolved, one of its upvalues, or a global.
+void Resolver::resolveName(const Name& name, Access& access, int& slot){
+    if (Local* local = this->local(name.symbol)) {
+        access = local->captured ? Access::CELL : Access::LOCAL;
+        slot = local->slot;
+        local->uses.push_back(&access);
+        return;
+    }
+    slot = resolveUpvalue(*current, name.symbol);
+    if (slot >= 0) {
+        access = Access::UPVALUE;
+        return;
+    }
+    access = Access::GLOBAL;
+    slot = globals.slot(name.symbol);
+}
+
+// The index of the upvalue through which `function` sees `name`, adding it
+// and those of the functions in between if needed, or -1 if it's a global.
+int Resolver::resolveUpvalue(FunctionScope& function, Symbol name){
+    for (size_t i = 0; i < function.upvalues.size(); i++) {
+        if (function.upvalues[i].name == name) return i;
+    }
+    if (function.frozen || function.enclosing == nullptr) return -1;
+
+    FunctionScope& enclosing = *function.enclosing;
+    for (int i = enclosing.scopes.size() - 1; i >= 0; i--) {
+        auto it = enclosing.scopes[i].locals.find(name);
+        if (it != enclosing.scopes[i].locals.end()){
+            it->second.captured = true;
+            function.upvalues.push_back({true, it->second.slot, name, it->second.function});
+            return function.upvalues.size() - 1;
+        }
+    }
+    int index = resolveUpvalue(enclosing, name);
+    if (index < 0) return -1;
+    function.upvalues.push_back({false, uint32_t(index), name, enclosing.upvalues[index].function});
+    return function.upvalues.size() - 1;
+}
+
+// Where the Resolver keeps the function a variable was declared with, if it
+// was a `fun`. A global's is kept in the unit.
+FunctionStmt** Resolver::function(Access access, int slot, Symbol name){
+    switch (access) {
+        case Access::LOCAL:
+        case Access::CELL: {
+            Local* local = this->local(name);
+            return local != nullptr ? &local->function : nullptr;
+        }
+        case Access::UPVALUE: return &current->upvalues[slot].function;
+        case Access::GLOBAL: {
+            auto it = unit->functions.find(slot);
+            return it != unit->functions.end() ? &it->second : nullptr;
         }
     }
+    return nullptr;
 }
 
-void Resolver::resolveFunction(FunctionStmt& function, FunctionType ftype){
+void Resolver::resolveBody(FunctionStmt& function){
+    unit = function.unit;
+    FunctionScope body;
+    body.frozen = true;
+    body.upvalues.assign(function.upvalues.begin(), function.upvalues.end());
+    resolveFunction(function, body, FunctionType::FUNCTION);
+}
+
+void Resolver::resolveFunction(FunctionStmt& function, FunctionScope& scope, FunctionType ftype){
     FunctionType enclosingFunction = currentFunction;
+    FunctionScope* enclosing = current;
     currentFunction = ftype;
+    current = &scope;
     beginScope();
-    for (Token param : function.params){
-        declare(param);
+    for (const Name& param : function.params){
+        declare(param, nullptr);
         define(param);
 
     }
     resolve(function.body);
+    std::vector<bool> cells;
+    for (const Name& param : function.params){
+        cells.push_back(scope.scopes.back().locals[param.symbol].captured);
+    }
     endScope();
 
+    Arena& arena = function.unit->arena;
+    function.cellParams = List<bool>(arena, cells);
+    function.locals = scope.size;
+    if (!scope.frozen) function.upvalues = List<Upvalue>(arena, scope.upvalues);
+    current = enclosing;
     currentFunction = enclosingFunction;
 }
 
@@ -71,7 +170,9 @@ void Resolver::resolveFunction(FunctionStmt& function, FunctionType ftype){
 
 
 void Resolver::visitVarStmt(VarStmt& stmt) {
-    declare(stmt.name);
+    stmt.slot = declare(stmt.name, &stmt.access);
+    stmt.access = stmt.slot < 0 ? Access::GLOBAL : Access::LOCAL;
+    if (stmt.slot < 0) stmt.slot = globals.slot(stmt.name.symbol);
     if (stmt.initializer != nullptr) {
         resolve(stmt.initializer);
     }
@@ -89,10 +190,27 @@ void Resolver::visitBlockStmt(BlockStmt& stmt){
 
 
 void Resolver::visitFunctionStmt(FunctionStmt& stmt){
-    declare(stmt.name);
+    stmt.slot = declare(stmt.name, &stmt.access);
+    stmt.access = stmt.slot < 0 ? Access::GLOBAL : Access::LOCAL;
+    if (stmt.slot < 0) {
+        stmt.slot = globals.slot(stmt.name.symbol);
+        unit->functions[stmt.slot] = &stmt;
+    } else {
+        local(stmt.name.symbol)->function = &stmt;
+    }
     define(stmt.name);
 
-    resolveFunction(stmt, FunctionType::FUNCTION);
+    FunctionScope inner;
+    inner.enclosing = current;
+    if (stmt.lazy != nullptr) {
+        // the body is resolved when it is parsed; what it captures is decided
+        // now, from the names it uses
+        for (Symbol name : stmt.lazy->names) resolveUpvalue(inner, name);
+        stmt.upvalues = List<Upvalue>(stmt.unit->arena, inner.upvalues);
+        return;
+    }
+
+    resolveFunction(stmt, inner, FunctionType::FUNCTION);
     return;
 
 }
@@ -120,71 +238,87 @@ void Resolver::visitReturnStmt(ReturnStmt& stmt){
     }
     if(stmt.value != nullptr){
         resolve(stmt.value);
+        stmt.tailCall = currentFunction != FunctionType::NONE && stmt.value->kind == ExprKind::CALL;
     }
     return;
 }
 
+// imported names are globals, which aren't tracked
+void Resolver::visitImportStmt(ImportStmt&){
+    return;
+}
+
 void Resolver::visitWhileStmt(WhileStmt& stmt){
     resolve(stmt.condition);
     resolve(stmt.body);
     return;
 }
 
-Value* Resolver::visitBinary(Binary& expr){ 
-    resolve(&expr.left);
-    resolve(&expr.right);
-    return new Value();
+Value Resolver::visitBinary(Binary& expr){ 
+    resolve(expr.left);
+    resolve(expr.right);
+    return Value();
 }
 
 
-Value* Resolver::visitCallExpr(Call& expr){ 
+Value Resolver::visitCallExpr(Call& expr){ 
     resolve(expr.callee);
+    if (expr.callee->kind == ExprKind::VARIABLE) {
+        Variable* callee = static_cast<Variable*>(expr.callee);
+        FunctionStmt** declared = function(callee->access, callee->slot, callee->name.symbol);
+        if (declared != nullptr) expr.target = *declared;
+    }
     for (Expr*  argument: expr.arguments){
         resolve(argument); 
     }
-    return new Value();
+    return Value();
 }
  
-Value* Resolver::visitGrouping(Grouping& expr){
-    resolve(&expr.expression);
-    return new Value(); 
+Value Resolver::visitGrouping(Grouping& expr){
+    resolve(expr.expression);
+    return Value(); 
 }
 
-Value* Resolver::visitLiteral(Literal& expr){
-    return new Value();
+Value Resolver::visitLiteral(Literal&){
+    return Value();
 }
 
-Value* Resolver::visitLogicalExpr(Logical& expr){
+Value Resolver::visitLogicalExpr(Logical& expr){
     resolve(expr.left);
     resolve(expr.right);
-    return new Value();
+    return Value();
 }
 
-Value* Resolver::visitUnary(Unary& expr) {
-    resolve(&expr.right);
-    return new Value();
+Value Resolver::visitUnary(Unary& expr) {
+    resolve(expr.right);
+    return Value();
  }
 
 
-Value* Resolver::visitVariable(Variable& expr){ 
+Value Resolver::visitVariable(Variable& expr){ 
 
 
-    if (!(scopes.size() == 0)){ 
-        auto temp = (*scopes[scopes.size() -1]);
-        if (temp.find(expr.name.lexeme) != temp.end()){
-            if (temp[expr.name.lexeme] == false){
-                error(expr.name.line,
-                "Can't read local variable in its own initializer.");
-            }
+    if (!(current->scopes.size() == 0)){ 
+        const Scope& scope = current->scopes.back();
+        auto it = scope.locals.find(expr.name.symbol);
+        if (it != scope.locals.end() && !it->second.defined){
+            error(expr.name.line,
+            "Can't read local variable in its own initializer.");
         }
-    // if (!(scopes.size() == 0) && (*scopes[scopes.size() -1]).at(expr.name.lexeme) == false) {
     }
-    resolveLocal(&expr, expr.name);
-    return new Value();
+    resolveName(expr.name, expr.access, expr.slot);
+    return Value();
 }
 
-Value* Resolver::visitAssign(Assign& expr){
+Value Resolver::visitAssign(Assign& expr){
     resolve(expr.value);
-    resolveLocal(&expr, expr.name);
-    return new Value(); 
+    resolveName(expr.name, expr.access, expr.slot);
+    FunctionStmt** declared = function(expr.access, expr.slot, expr.name.symbol);
+    if (declared != nullptr) *declared = nullptr;
+    return Value(); 
+}
+
+// made after resolution
+Value Resolver::visitInline(Inline&){
+    return Value();
 }
\ No newline at end of file
@@ -8,6 +8,36 @@
 #include "error.hpp"
 #include "environment.hpp"
 #include "interpreter.hpp"
+#include "unit.hpp"
+
+// A local as the Resolver sees it: its slot in the frame, whether a closure
+// captures it, and the nodes that refer to it, which are switched to the cell
+// when its scope ends if one does. `function` is the `fun` that declared it,
+// until something is assigned to it.
+struct Local {
+    uint32_t slot;
+    bool defined = false;
+    bool captured = false;
+    std::vector<Access*> uses;
+    FunctionStmt* function = nullptr;
+};
+
+// The locals one block declares.
+struct Scope {
+    std::unordered_map<Symbol, Local> locals;
+};
+
+// A function being resolved. All its blocks share its frame, and a block's
+// slots are reused once it ends. A body resolved after its declaration has no
+// enclosing function: its upvalues were fixed then, and are found by name.
+struct FunctionScope {
+    FunctionScope* enclosing = nullptr;
+    std::vector<Scope> scopes; //stack
+    uint32_t next = 0;
+    uint32_t size = 0;
+    std::vector<Upvalue> upvalues;
+    bool frozen = false;
+};
 
 enum class FunctionType {
     NONE, 
@@ -18,16 +48,19 @@ class Resolver: public ExprVisitor, public StmtVisitor{
 public:
     FunctionType currentFunction = FunctionType::NONE;
 
-    Resolver(Interpreter* interpreter) : interpreter(interpreter) {};
+    // globals are numbered in the table of the unit being resolved
+    explicit Resolver(Globals& globals) : globals(globals) {}
+
 
-    Value* visitBinary(Binary& expr);
-    Value* visitGrouping(Grouping& expr) ;
-    Value* visitLiteral(Literal& expr) ;
-    Value* visitUnary(Unary& expr) ;
-    Value* visitVariable(Variable& expr);
-    Value* visitAssign(Assign& expr);
-    Value* visitLogicalExpr(Logical& expr);
-    Value* visitCallExpr(Call& expr);
+    Value visitBinary(Binary& expr);
+    Value visitGrouping(Grouping& expr) ;
+    Value visitLiteral(Literal& expr) ;
+    Value visitUnary(Unary& expr) ;
+    Value visitVariable(Variable& expr);
+    Value visitAssign(Assign& expr);
+    Value visitLogicalExpr(Logical& expr);
+    Value visitCallExpr(Call& expr);
+    Value visitInline(Inline& expr);
 
     void visitFunctionStmt(FunctionStmt& stmt);
     void visitExprStmt(ExprStmt& stmt);
@@ -37,23 +70,31 @@ public:
     void visitIfStmt(IfStmt& stmt);
     void visitWhileStmt(WhileStmt& stmt) ;
     void visitReturnStmt(ReturnStmt& stmt);
+    void visitImportStmt(ImportStmt& stmt);
 
-    void resolve(std::vector<Statement*> statements);
+    // the top-level code of a script, module or REPL line
+    void resolve(CompilationUnit& unit);
+    // a lazily parsed body, with the upvalues found at its declaration
+    void resolveBody(FunctionStmt& function);
 
 private: 
 
-    Interpreter* interpreter;
-
-     std::vector<std::unordered_map<std::string, bool>*> scopes; //stack
+     FunctionScope* current = nullptr;
+     CompilationUnit* unit = nullptr;
+     Globals& globals;
 
+    void resolve(const List<Statement*>& statements);
     void resolve(Statement* statement);
     void resolve(Expr* expr);
     void beginScope();
     void endScope();
-    void declare(Token name);
-    void define(Token name);
-    void resolveLocal(Expr* expr, Token name);
-    void resolveFunction(FunctionStmt& function, FunctionType ftype);
+    int declare(const Name& name, Access* access);
+    void define(const Name& name);
+    Local* local(Symbol name);
+    void resolveName(const Name& name, Access& access, int& slot);
+    FunctionStmt** function(Access access, int slot, Symbol name);
+    int resolveUpvalue(FunctionScope& function, Symbol name);
+    void resolveFunction(FunctionStmt& function, FunctionScope& scope, FunctionType ftype);
 
 
     
@@ -0,0 +1,179 @@
+#ifndef SCAN_KERNELS_H_
+#define SCAN_KERNELS_H_
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Run-skipping kernels for the scanner. Each one takes the current position and
+// the end of the source and returns the first position that is not part of the
+// run. The vector versions look at 16 (SSE2) or 32 (AVX2) bytes at a time and
+// hand the tail to the scalar versions, which are also used on other targets.
+namespace kernels {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+inline bool isAlnum(char c) { return isDigit(c) || isAlpha(c); }
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+namespace scalar {
+
+// spaces, tabs and newlines, counting the newlines into `lines`
+inline const char* skipBlank(const char* p, const char* end, int& lines) {
+    for (; p < end && isBlank(*p); p++)
+        if (*p == '\n') lines++;
+    return p;
+}
+
+// up to the first `target`, counting the newlines passed on the way
+inline const char* scanUntil(const char* p, const char* end, char target, int& lines) {
+    for (; p < end && *p != target; p++)
+        if (*p == '\n') lines++;
+    return p;
+}
+
+inline const char* skipAlnum(const char* p, const char* end) {
+    while (p < end && isAlnum(*p)) p++;
+    return p;
+}
+
+inline const char* skipDigits(const char* p, const char* end) {
+    while (p < end && isDigit(*p)) p++;
+    return p;
+}
+
+} // namespace scalar
+
+#if defined(__SSE2__)
+
+// Compares return one bit per byte. Range checks use signed compares, which
+// is fine for the ASCII ranges we need since bytes >= 0x80 are negative.
+struct Sse2Lanes {
+    static const int width = 16;
+    static const uint32_t all = 0xffff;
+    __m128i v;
+
+    explicit Sse2Lanes(const char* p) : v(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    uint32_t eq(char c) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+    }
+    uint32_t inRange(__m128i x, char lo, char hi) const {
+        __m128i above = _mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1));
+        __m128i below = _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1));
+        return _mm_movemask_epi8(_mm_and_si128(above, below));
+    }
+    uint32_t digits() const { return inRange(v, '0', '9'); }
+    uint32_t alnums() const {
+        return digits() | inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    }
+};
+
+#endif
+
+#if defined(__AVX2__)
+
+struct Avx2Lanes {
+    static const int width = 32;
+    static const uint32_t all = 0xffffffff;
+    __m256i v;
+
+    explicit Avx2Lanes(const char* p) : v(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) {}
+
+    uint32_t eq(char c) const {
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+    }
+    uint32_t inRange(__m256i x, char lo, char hi) const {
+        __m256i above = _mm256_cmpgt_epi8(x, _mm256_set1_epi8(lo - 1));
+        __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), x);
+        return _mm256_movemask_epi8(_mm256_and_si256(above, below));
+    }
+    uint32_t digits() const { return inRange(v, '0', '9'); }
+    uint32_t alnums() const {
+        return digits() | inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    }
+};
+
+#endif
+
+// bits below the first set bit of `hits`
+inline uint32_t before(uint32_t hits) {
+    return (1u << __builtin_ctz(hits)) - 1;
+}
+
+template <class Lanes>
+const char* skipBlank(const char* p, const char* end, int& lines) {
+    for (; end - p >= Lanes::width; p += Lanes::width) {
+        Lanes block(p);
+        uint32_t newlines = block.eq('\n');
+        uint32_t other = ~(newlines | block.eq(' ') | block.eq('\t') | block.eq('\r')) & Lanes::all;
+        if (other) {
+            lines += __builtin_popcount(newlines & before(other));
+            return p + __builtin_ctz(other);
+        }
+        lines += __builtin_popcount(newlines);
+    }
+    return scalar::skipBlank(p, end, lines);
+}
+
+template <class Lanes>
+const char* scanUntil(const char* p, const char* end, char target, int& lines) {
+    for (; end - p >= Lanes::width; p += Lanes::width) {
+        Lanes block(p);
+        uint32_t newlines = block.eq('\n');
+        uint32_t hits = block.eq(target);
+        if (hits) {
+            lines += __builtin_popcount(newlines & before(hits));
+            return p + __builtin_ctz(hits);
+        }
+        lines += __builtin_popcount(newlines);
+    }
+    return scalar::scanUntil(p, end, target, lines);
+}
+
+template <class Lanes>
+const char* skipAlnum(const char* p, const char* end) {
+    for (; end - p >= Lanes::width; p += Lanes::width) {
+        uint32_t other = ~Lanes(p).alnums() & Lanes::all;
+        if (other) return p + __builtin_ctz(other);
+    }
+    return scalar::skipAlnum(p, end);
+}
+
+template <class Lanes>
+const char* skipDigits(const char* p, const char* end) {
+    for (; end - p >= Lanes::width; p += Lanes::width) {
+        uint32_t other = ~Lanes(p).digits() & Lanes::all;
+        if (other) return p + __builtin_ctz(other);
+    }
+    return scalar::skipDigits(p, end);
+}
+
+// Widest kernels the target was compiled for.
+namespace vector {
+
+#if defined(__AVX2__)
+using Lanes = Avx2Lanes;
+#elif defined(__SSE2__)
+using Lanes = Sse2Lanes;
+#endif
+
+#if defined(__SSE2__)
+inline const char* skipBlank(const char* p, const char* end, int& lines) { return kernels::skipBlank<Lanes>(p, end, lines); }
+inline const char* scanUntil(const char* p, const char* end, char target, int& lines) { return kernels::scanUntil<Lanes>(p, end, target, lines); }
+inline const char* skipAlnum(const char* p, const char* end) { return kernels::skipAlnum<Lanes>(p, end); }
+inline const char* skipDigits(const char* p, const char* end) { return kernels::skipDigits<Lanes>(p, end); }
+#else
+using scalar::skipBlank;
+using scalar::scanUntil;
+using scalar::skipAlnum;
+using scalar::skipDigits;
+#endif
+
+} // namespace vector
+
+} // namespace kernels
+
+#endif //SCAN_KERNELS_H_
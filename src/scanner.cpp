@@ -4,17 +4,128 @@
 #include <fstream>
 #include <cctype>
 #include <unordered_map>
+#include <thread>
 
 #include "scanner.hpp"
 
 std::vector<Token> Scanner::scanTokens() {
-    while (!isAtEnd()){ 
+    scanAll();
+    return std::move(tokens);
+}
+
+// Only sources big enough to scan in parallel are scanned ahead of the parser;
+// everything else is scanned a token at a time, reusing the same small buffer.
+Token Scanner::next() {
+    if (read == tokens.size()) {
+        tokens.clear();
+        read = 0;
+        if (!started && threads > 1 && source.length() >= 2 * MIN_CHUNK) {
+            scanAll();
+        } else {
+            scanNext();
+        }
+    }
+    return tokens[read++];
+}
+
+void Scanner::scanAll() {
+    started = true;
+    if (implicitBlock) tokens.push_back(Token(TokenType::LEFT_BRACE, "{", 1, line));
+
+    if (threads > 1 && source.length() >= 2 * MIN_CHUNK) {
+        scanChunks();
+    } else {
+        scanRange(0, source.length());
+    }
+
+    if (implicitBlock) tokens.push_back(Token(TokenType::RIGHT_BRACE, "}", 1, line));
+    start = current;
+    addToken(TokenType::EOF_);
+    finished = true;
+    reportErrors();
+}
+
+void Scanner::scanNext() {
+    if (!started) {
+        started = true;
+        if (implicitBlock) tokens.push_back(Token(TokenType::LEFT_BRACE, "{", 1, line));
+    }
+
+    while (tokens.empty() && !isAtEnd()) {
         start = current;
         scanToken();
     }
 
-    addToken(TokenType::EOF_);
-    return tokens;
+    if (tokens.empty()) {
+        if (!finished && implicitBlock) tokens.push_back(Token(TokenType::RIGHT_BRACE, "}", 1, line));
+        finished = true;
+        start = current;
+        addToken(TokenType::EOF_);
+    }
+    reportErrors();
+}
+
+void Scanner::reportErrors() {
+    for (auto& [at, message] : errors) error(at, message);
+    errors.clear();
+}
+
+void Scanner::scanRange(size_t from, size_t to) {
+    current = from;
+    while (current < to && !isAtEnd()){ 
+        start = current;
+        scanToken();
+    }
+}
+
+// Splits the source right after a newline that is followed by something other
+// than whitespace, so that in the common case a chunk's last token ends exactly
+// where the next chunk begins. When it doesn't, a string or block comment ran
+// across the boundary and the next chunk is scanned again from where it ended.
+void Scanner::scanChunks() {
+    size_t count = std::min<size_t>(threads, source.length() / MIN_CHUNK);
+    std::vector<size_t> bounds = {0};
+    for (size_t i = 1; i < count; i++) {
+        size_t split = std::max(bounds.back() + 1, source.length() / count * i);
+        while (split < source.length() && !(source[split - 1] == '\n' && !kernels::isBlank(source[split])))
+            split++;
+        if (split < source.length()) bounds.push_back(split);
+    }
+    bounds.push_back(source.length());
+
+    std::vector<Chunk> chunks(bounds.size() - 1);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        workers.emplace_back([this, &chunks, &bounds, i] {
+            chunks[i] = scanChunk(bounds[i], bounds[i + 1]);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    for (Chunk& chunk : chunks) {
+        if (current >= chunk.end) continue;
+        if (current != chunk.begin) chunk = scanChunk(current, chunk.end);
+
+        for (Token& token : chunk.tokens) {
+            token.line += line - 1;
+            tokens.push_back(token);
+        }
+        for (auto& [at, message] : chunk.errors)
+            errors.push_back({at + line - 1, message});
+
+        line += chunk.lines - 1;
+        current = chunk.stop;
+    }
+}
+
+Scanner::Chunk Scanner::scanChunk(size_t begin, size_t end) {
+    Scanner worker(source, vectorized);
+    worker.scanRange(begin, end);
+    return Chunk{begin, end, worker.current, worker.line, std::move(worker.tokens), std::move(worker.errors)};
+}
+
+void Scanner::report(const std::string& message) {
+    errors.push_back({line, message});
 }
 
 
@@ -53,13 +164,13 @@ void Scanner::scanToken(){
         case '/':
             if (match('/')) {
                 // A comment goes until the end of the line.
-                while (peek() != '\n' && !isAtEnd()) advance();
+                skipUntil('\n');
             } else if(match('*')) {
                 //block comment start
-                while (peek() != '*' && !isAtEnd()) advance();
+                skipUntil('*');
                 if(match('*') && match('/')) { break;}
                 else {
-                    error(line, "Invalid block comment.");
+                    report("Invalid block comment.");
                 } 
             } 
             else {
@@ -69,12 +180,14 @@ void Scanner::scanToken(){
 
 
         // Ignore whitespace.
+        case '\n':
+            line++;
+            // the rest of the run is skipped in one go
+            [[fallthrough]];
         case ' ':
         case '\r':
         case '\t':
-            break;
-        case '\n':
-            line++;
+            skipBlank();
             break;
 
         case '"': string(); break;
@@ -86,7 +199,7 @@ void Scanner::scanToken(){
             }  else if (std::isalpha(c)) {
                 identifier();
             } else{
-                error(line, "Unexepected character.");
+                report("Unexepected character.");
             }
             break; 
     }
@@ -94,46 +207,32 @@ void Scanner::scanToken(){
 
 
 void Scanner::identifier() {
-    while (std::isalnum(peek())) advance();
-    std::string text = source.substr(start, current-start);
-    TokenType type; 
-
-    auto it = keywords.find(text);
-    if (it != keywords.end()) {
-        type = it->second; // Keyword found in the map
-    } else {
-        type = TokenType::IDENTIFIER; // Default to IDENTIFIER
-    }
-
-    addToken(type);
+    skipAlnum();
+    addToken(keywordType(source.substr(start, current-start)));
 
 }
 void Scanner::number() {
-    while (std::isdigit(peek())) advance();
+    skipDigits();
     // Look for a fractional part.
     if (peek() == '.' && std::isdigit(peekNext())) {
     // Consume the "."
     advance();
-    while (std::isdigit(peek())) advance();
+    skipDigits();
     }
-    addToken(TokenType::NUMBER, source.substr(start, current-start));
+    addToken(TokenType::NUMBER);
 }
 
 void Scanner::string() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') line++;
-        advance();
-    }
+    skipUntil('"');
     if (isAtEnd()) {
-        error(line, "Unterminated string.");
+        report("Unterminated string.");
         return;
     }
 
     // The closing ".
     advance();
 
-    std::string value = source.substr(start + 1, (current - 1) - (start + 1));
-    addToken(TokenType::STRING, value);
+    addToken(TokenType::STRING);
 }
 
 char Scanner::peek() {
@@ -159,13 +258,41 @@ char Scanner::advance(){
     return source[current - 1];
 }
 
-// Function to add a token with no literal
-void Scanner::addToken(TokenType type) {
-    addToken(type, "NULL"); 
+void Scanner::seek(const char* position) {
+    current = position - source.data();
+}
+
+void Scanner::skipBlank() {
+    const char* end = source.data() + source.length();
+    seek(vectorized ? kernels::vector::skipBlank(source.data() + current, end, line)
+                    : kernels::scalar::skipBlank(source.data() + current, end, line));
+}
+
+// Stops on `target` or at the end of the source, counting newlines.
+void Scanner::skipUntil(char target) {
+    const char* end = source.data() + source.length();
+    seek(vectorized ? kernels::vector::scanUntil(source.data() + current, end, target, line)
+                    : kernels::scalar::scanUntil(source.data() + current, end, target, line));
 }
-// Function to add a token with a literal
-void Scanner::addToken(TokenType type, std::string literal){
-    std::string text = source.substr(start, current - start);
-    tokens.push_back(Token(type, text, literal, line));
+
+void Scanner::skipAlnum() {
+    const char* end = source.data() + source.length();
+    seek(vectorized ? kernels::vector::skipAlnum(source.data() + current, end)
+                    : kernels::scalar::skipAlnum(source.data() + current, end));
+}
+
+void Scanner::skipDigits() {
+    const char* end = source.data() + source.length();
+    seek(vectorized ? kernels::vector::skipDigits(source.data() + current, end)
+                    : kernels::scalar::skipDigits(source.data() + current, end));
+}
+
+// The token only records where its lexeme sits in the source.
+void Scanner::addToken(TokenType type) {
+    if (current - start > Token::MAX_LENGTH) {
+        report("Token too long.");
+        return;
+    }
+    tokens.push_back(Token(type, source.data() + start, current - start, line));
 }
 
@@ -2,22 +2,57 @@
 #define SCANNER_H_
 
 #include "types.hpp"
+#include "scan_kernels.hpp"
 
 class Scanner{
 public:
-    Scanner(const std::string& source) : source(source) {}
+    // `vectorized` picks the SIMD run kernels over the scalar ones
+    Scanner(std::string_view source, bool vectorized = true) : source(source), vectorized(vectorized) {}
     std::vector<Token> scanTokens();
+    // pulls one token, scanning only as far as needed to produce it
+    Token next();
+
+    // for a slice of a bigger source, the line the slice starts on
+    void startLine(int line) { this->line = line; }
+
+    // wraps the tokens in a block of their own, which is how scripts are run
+    bool implicitBlock = false;
+
+    // sources big enough to split are scanned in chunks on this many threads
+    unsigned threads = 1;
+    static const size_t MIN_CHUNK = 1 << 20;
     
 
 private:
-    std::string source;
+    // Tokens of one slice of the source. Lines are counted from the start of
+    // the slice, and `stop` is where its last token really ended.
+    struct Chunk {
+        size_t begin, end, stop;
+        int lines;
+        std::vector<Token> tokens;
+        std::vector<std::pair<int, std::string>> errors;
+    };
+
+    std::string_view source;
     std::vector<Token> tokens;
-    int start = 0; 
-    int current = 0;
+    size_t read = 0; // tokens already handed out by next()
+    bool started = false;
+    bool finished = false;
+    std::vector<std::pair<int, std::string>> errors;
+    size_t start = 0; 
+    size_t current = 0;
     int line = 1;
+    bool vectorized;
 
     bool isAtEnd();
     void scanToken();
+    void scanAll();
+    void scanNext();
+    void reportErrors();
+    void scanRange(size_t from, size_t to);
+    void scanChunks();
+    Chunk scanChunk(size_t begin, size_t end);
+    void report(const std::string& message);
 
 
     void identifier();
@@ -29,9 +64,14 @@ private:
     bool match(char expected);
     char advance();
 
+    void seek(const char* position);
+    void skipBlank();
+    void skipUntil(char target);
+    void skipAlnum();
+    void skipDigits();
+
     
-    void addToken(TokenType type); // w no literal
-    void addToken(TokenType type, std::string literal); //w literal
+    void addToken(TokenType type);
 };
 
 #endif //SCANNER_H_ 
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef SOURCE_H_
+#define SOURCE_H_
+
+#include <string>
+#include <string_view>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The text of a script. Files are mapped read-only where the platform allows
+// it, so the scanner reads the pages directly instead of a copy of them.
+class Source {
+public:
+    explicit Source(std::string text) : owned(std::move(text)) {
+        data = owned.data();
+        size = owned.size();
+    }
+
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+
+    ~Source() {
+#ifndef _WIN32
+        if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+    }
+
+    // nullptr if the file can't be opened
+    static Source* load(const char* path) {
+#ifndef _WIN32
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return nullptr;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* pages = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (pages != MAP_FAILED) {
+                close(fd);
+                madvise(pages, info.st_size, MADV_SEQUENTIAL);
+                Source* source = new Source();
+                source->data = static_cast<const char*>(pages);
+                source->size = info.st_size;
+                source->mapped = true;
+                return source;
+            }
+        }
+        close(fd);
+#endif
+        // empty files, pipes and platforms without mmap
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return nullptr;
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return new Source(std::move(contents));
+    }
+
+    std::string_view text() const {
+        return std::string_view(data, size);
+    }
+
+private:
+    Source() {}
+
+    std::string owned;
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+};
+
+#endif //SOURCE_H_
@@ -0,0 +1,42 @@
+#ifndef SYMBOLS_H_
+#define SYMBOLS_H_
+
+#include <cstdint>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Identifiers are interned once, when the parser first reads them, and from
+// then on scopes and environments compare and hash the integer id instead of
+// the characters. Modules are parsed on several threads, so the table locks.
+using Symbol = uint32_t;
+
+class SymbolTable {
+public:
+    Symbol intern(std::string_view name) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+
+        Symbol symbol = names.size();
+        const std::string& stored = names.emplace_back(name);
+        ids[stored] = symbol;
+        return symbol;
+    }
+
+    std::string_view name(Symbol symbol) {
+        std::lock_guard<std::mutex> guard(lock);
+        return names[symbol];
+    }
+
+private:
+    std::mutex lock;
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, Symbol> ids;
+};
+
+inline SymbolTable symbols;
+
+#endif //SYMBOLS_H_
@@ -0,0 +1,72 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running queued tasks. Tasks may queue more
+// tasks; wait() returns once the queue is empty and every worker is idle.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads) {
+        if (threads == 0) threads = 1;
+        for (unsigned i = 0; i < threads; i++) workers.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> guard(lock);
+        idle.wait(guard, [this] { return tasks.empty() && busy == 0; });
+    }
+
+private:
+    void work() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            busy++;
+            guard.unlock();
+            task();
+            guard.lock();
+            busy--;
+            if (tasks.empty() && busy == 0) idle.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    unsigned busy = 0;
+    bool stopping = false;
+};
+
+#endif //THREADPOOL_H_
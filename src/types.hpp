@@ -3,21 +3,29 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <sstream> 
 #include <vector>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <cctype>
 #include <unordered_map>
 
+#include "symbols.hpp"
+#include "arena.hpp"
+
 
 class Value; 
 class Interpreter; 
+class CompilationUnit;
+struct LazyBody;
 
 class LoxCallable{
 public: 
     // LoxCallable(){}
     virtual int arity() = 0;
-    virtual Value* call(Interpreter* interpreter, std::vector<Value*> arguments) = 0;
+    virtual Value call(Interpreter* interpreter, std::vector<Value> arguments) = 0;
     virtual std::string toString() = 0 ;
 };
 
@@ -45,67 +53,98 @@ std::string valueTypeToString(ValueType value) {
 }
 
 
-struct Value{
-    ValueType type;
-    union {
-        double number;
-        std::string str; 
-        bool bool_;
-        LoxCallable* callable;
-    };
+// A value in 8 bytes, passed around by copy. Numbers are NaN-boxed the way
+// JavaScriptCore does it: a double is kept as its bits plus 2^49, which puts
+// every double at or above 2^49 and leaves the patterns below, which were NaNs
+// with the sign set, to everything else. A pointer to a callable is kept as it
+// is, a pointer to a string with its low bit set, and nil, false and true are
+// small constants. No bits set at all is no value, for a variable that has
+// not been defined yet.
+//
+// Strings don't change once made. Like the boxed values before them, those
+// made while running are never freed.
+class Value {
+public:
+    Value() : bits(NIL) {}
+    Value(double value) {
+        std::memcpy(&bits, &value, sizeof(bits));
+        // NaNs with a payload past the default one would wrap around
+        if (bits > NEGATIVE_NAN) bits = NEGATIVE_NAN;
+        bits += DOUBLE_OFFSET;
+    }
+    Value(int value) : Value(static_cast<double>(value)) {}
+    Value(bool value) : bits(value ? TRUE : FALSE) {}
+    Value(LoxCallable* value) : bits(reinterpret_cast<uintptr_t>(value)) {}
+    // refers to `text`, which has to outlive it
+    Value(const std::string* text) : bits(reinterpret_cast<uintptr_t>(text) | STRING_BIT) {}
+    // a new string
+    explicit Value(std::string text) : Value(new std::string(std::move(text))) {}
+
+    static Value undefined() {
+        Value value;
+        value.bits = 0;
+        return value;
+    }
 
-    Value(int value) : type(ValueType::NUMBER), number(value) {}
-    Value(double value) : type(ValueType::NUMBER), number(value) {}
-    Value(bool value) : type(ValueType::BOOLEAN), bool_(value) {}
-    Value() : type(ValueType::NIL) {}
-    Value(const std::string& value) : type(ValueType::STRING), str(value) {}
-    Value(LoxCallable* value) : type(ValueType::CALLABLE), callable(value) {}
-    
-    std::string view(){
+    bool defined() const { return bits != 0; }
+    bool isNumber() const { return bits >= DOUBLE_OFFSET; }
+
+    ValueType type() const {
+        if (bits >= DOUBLE_OFFSET) return ValueType::NUMBER;
+        if (bits <= NIL) return ValueType::NIL;
+        if (bits <= TRUE) return ValueType::BOOLEAN;
+        return (bits & STRING_BIT) != 0 ? ValueType::STRING : ValueType::CALLABLE;
+    }
+
+    double number() const {
+        uint64_t raw = bits - DOUBLE_OFFSET;
+        double value;
+        std::memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+    bool boolean() const { return bits == TRUE; }
+    const std::string& str() const { return *reinterpret_cast<const std::string*>(bits & ~STRING_BIT); }
+    LoxCallable* callable() const { return reinterpret_cast<LoxCallable*>(bits); }
+
+    // the same bits are the same number, string object, callable or constant
+    uint64_t raw() const { return bits; }
+
+    std::string view() const {
        std::ostringstream oss;
-    //    oss << "{ " << valueTypeToString(type) << " " ;
-       switch (type){
+       switch (type()){
             case ValueType::NUMBER:
-                oss << number;
+                oss << number();
                 break;
             case ValueType::STRING:
-                oss << str;
+                oss << str();
                 break;
             case ValueType::BOOLEAN:
-                oss << bool_;
+                oss << boolean();
                 break;
             case ValueType::CALLABLE:
-                oss << callable->toString();
+                oss << callable()->toString();
+                break;
+            // prints as nothing
+            case ValueType::NIL:
                 break;
        }
-    //    oss << " }";
-
        return oss.str();
     }
 
-    Value* operator=(const Value& other) {
-        if (this != &other) {
-            return new Value(other);
-        }
-        return this;
-    }
-
-    Value(const Value& other) {
-        type = other.type;
-        switch (other.type){
-            case ValueType::NUMBER: number = other.number; break;
-            case ValueType::STRING: str = other.str; break;
-            case ValueType::BOOLEAN: bool_ = other.bool_; break;
-            case ValueType::CALLABLE: callable= other.callable; break;
-        }
-    }
+private:
+    static constexpr uint64_t DOUBLE_OFFSET = 1ull << 49;
+    static constexpr uint64_t NEGATIVE_NAN = 0xfff8000000000000ull;
+    static constexpr uint64_t NIL = 2;
+    static constexpr uint64_t FALSE = 4;
+    static constexpr uint64_t TRUE = 6;
+    static constexpr uint64_t STRING_BIT = 1;
 
-    ~Value() {
-       
-    }
+    uint64_t bits;
 };
 
-enum class TokenType {
+static_assert(sizeof(Value) == 8, "a Value is one word");
+
+enum class TokenType : uint8_t {
     // Single-character tokens.
     LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE,
     COMMA, DOT, MINUS, PLUS, SEMICOLON, SLASH, STAR,
@@ -117,44 +156,108 @@ enum class TokenType {
     // Literals.
     IDENTIFIER, STRING, NUMBER,
     // Keywords.
-    AND, CLASS, ELSE, FALSE, FUN, FOR, IF, NIL, OR,
+    AND, CLASS, ELSE, FALSE, FUN, FOR, IF, IMPORT, NIL, OR,
     PRINT, RETURN, SUPER, THIS, TRUE, VAR, WHILE,
     EOF_ 
 };
 
-std::unordered_map<std::string, TokenType> keywords = {
-    {"and", TokenType::AND},
-    {"class", TokenType::CLASS},
-    {"else", TokenType::ELSE},
-    {"false", TokenType::FALSE},
-    {"for", TokenType::FOR},
-    {"fun", TokenType::FUN},
-    {"if", TokenType::IF},
-    {"nil", TokenType::NIL},
-    {"or", TokenType::OR},
-    {"print", TokenType::PRINT},
-    {"return", TokenType::RETURN},
-    {"super", TokenType::SUPER},
-    {"this", TokenType::THIS},
-    {"true", TokenType::TRUE},
-    {"var", TokenType::VAR},
-    {"while", TokenType::WHILE}
-};
-
-// we have NULL, string, double(nuumber) literals. we can always specify the fromstr conversion later
+// Keywords are told apart by their first character (and the second one where
+// that is shared) before a single full compare, so classifying an identifier
+// never allocates or hashes.
+constexpr TokenType keywordType(std::string_view text) {
+    auto keyword = [&](std::string_view word, TokenType type) {
+        return text == word ? type : TokenType::IDENTIFIER;
+    };
+
+    switch (text[0]) {
+        case 'a': return keyword("and", TokenType::AND);
+        case 'c': return keyword("class", TokenType::CLASS);
+        case 'e': return keyword("else", TokenType::ELSE);
+        case 'f':
+            if (text.length() < 2) break;
+            switch (text[1]) {
+                case 'a': return keyword("false", TokenType::FALSE);
+                case 'o': return keyword("for", TokenType::FOR);
+                case 'u': return keyword("fun", TokenType::FUN);
+            }
+            break;
+        case 'i':
+            if (text.length() < 2) break;
+            switch (text[1]) {
+                case 'f': return keyword("if", TokenType::IF);
+                case 'm': return keyword("import", TokenType::IMPORT);
+            }
+            break;
+        case 'n': return keyword("nil", TokenType::NIL);
+        case 'o': return keyword("or", TokenType::OR);
+        case 'p': return keyword("print", TokenType::PRINT);
+        case 'r': return keyword("return", TokenType::RETURN);
+        case 's': return keyword("super", TokenType::SUPER);
+        case 't':
+            if (text.length() < 2) break;
+            switch (text[1]) {
+                case 'h': return keyword("this", TokenType::THIS);
+                case 'r': return keyword("true", TokenType::TRUE);
+            }
+            break;
+        case 'v': return keyword("var", TokenType::VAR);
+        case 'w': return keyword("while", TokenType::WHILE);
+    }
+    return TokenType::IDENTIFIER;
+}
+
+// Tokens are 16 byte views into the source buffer, so the buffer has to outlive
+// them. The lexeme of a STRING token keeps its quotes, literal() strips them.
 class Token {
 public:
-    TokenType type;
-    std::string lexeme;
-    std::string literal;
+    static const uint32_t MAX_LENGTH = (1u << 24) - 1;
+
+    const char* start;
     int line;
+    TokenType type : 8;
+    uint32_t length : 24;
+
+    Token(TokenType type, const char* start, uint32_t length, int line) :
+        start(start), line(line), type(type), length(length) {}
+
+    Token() : Token(TokenType::EOF_, "", 0, 0) {}
+
+    std::string_view lexeme() const {
+        return std::string_view(start, length);
+    }
+
+    std::string_view literal() const {
+        if (type == TokenType::STRING) return lexeme().substr(1, length - 2);
+        return lexeme();
+    }
+
+    std::string toString() const {
+        bool hasLiteral = type == TokenType::STRING || type == TokenType::NUMBER;
+        return typeid(TokenType).name() + std::string(" ") + std::string(lexeme()) + " "
+            + (hasLiteral ? std::string(literal()) : std::string("NULL"));
+    }
+};
 
-    Token(TokenType type, const std::string& lexeme, const std::string& literal, int line) :
-        type(type), lexeme(lexeme), literal(literal), line(line) {}
 
-    std::string toString() {
-        return typeid(type).name() + std::string(" ") + lexeme + " " + literal;
+// An identifier token together with its interned symbol.
+class Name : public Token {
+public:
+    Name(const Token& token) : Token(token), symbol(symbols.intern(token.lexeme())) {}
+
+    // a local a pass adds, on `line`, named "$t" so that it can't clash with
+    // an identifier or point into the source
+    static Name temporary(int line) {
+        static const Symbol symbol = symbols.intern(TEMPORARY);
+        return Name(Token(TokenType::IDENTIFIER, TEMPORARY, sizeof(TEMPORARY) - 1, line), symbol);
     }
+    bool isTemporary() const { return start == TEMPORARY; }
+
+    Symbol symbol;
+
+private:
+    static constexpr char TEMPORARY[] = "$t";
+
+    Name(const Token& token, Symbol symbol) : Token(token), symbol(symbol) {}
 };
 
 
@@ -166,6 +269,7 @@ class Call;
 class Variable;
 class Assign;
 class Logical;
+class Inline;
 
 class ExprStmt;
 class PrintStmt;
@@ -175,17 +279,48 @@ class IfStmt;
 class FunctionStmt;
 class WhileStmt;
 class ReturnStmt;
+class ImportStmt;
+struct Module;
+
+// Every node carries its kind so the interpreter can dispatch with one switch
+// instead of accept() followed by a visit call. The visitors stay for the
+// resolver and the printer.
+enum class ExprKind : uint8_t {
+    BINARY, GROUPING, LITERAL, CALL, UNARY, VARIABLE, ASSIGN, LOGICAL, INLINE
+};
+
+enum class StmtKind : uint8_t {
+    PRINT, EXPR, VAR, BLOCK, IF, WHILE, FUNCTION, RETURN, IMPORT
+};
+
+// Where the Resolver found a variable: a slot in the frame of the function
+// running, the same but holding a cell because a closure captured it, one of
+// the running closure's upvalues, or an index in the unit's globals.
+enum class Access : uint8_t {
+    LOCAL, CELL, UPVALUE, GLOBAL
+};
+
+// A variable a closure captures when it is created: a captured slot in the
+// frame declaring it, or an upvalue of that frame's own closure. `function`
+// is the declaration that defined it, if it was a `fun` not assigned since.
+struct Upvalue {
+    bool local;
+    uint32_t index;
+    Symbol name;
+    FunctionStmt* function;
+};
 
 class ExprVisitor {
 public:
-    virtual Value* visitBinary(Binary& expr) = 0;
-    virtual Value* visitGrouping(Grouping& expr) = 0;
-    virtual Value* visitLiteral(Literal& expr) = 0;
-    virtual Value* visitCallExpr(Call& expr) = 0;
-    virtual Value* visitUnary(Unary& expr) = 0;
-    virtual Value* visitVariable(Variable& expr) = 0;
-    virtual Value* visitAssign(Assign& expr) = 0;
-    virtual Value* visitLogicalExpr(Logical& expr) = 0;
+    virtual Value visitBinary(Binary& expr) = 0;
+    virtual Value visitGrouping(Grouping& expr) = 0;
+    virtual Value visitLiteral(Literal& expr) = 0;
+    virtual Value visitCallExpr(Call& expr) = 0;
+    virtual Value visitUnary(Unary& expr) = 0;
+    virtual Value visitVariable(Variable& expr) = 0;
+    virtual Value visitAssign(Assign& expr) = 0;
+    virtual Value visitLogicalExpr(Logical& expr) = 0;
+    virtual Value visitInline(Inline& expr) = 0;
     virtual ~ExprVisitor() {}
 };
 
@@ -199,30 +334,32 @@ public:
     virtual void visitWhileStmt(WhileStmt& stmt) = 0;     
     virtual void visitFunctionStmt(FunctionStmt& stmt) = 0;     
     virtual void visitReturnStmt(ReturnStmt& stmt) = 0;     
+    virtual void visitImportStmt(ImportStmt& stmt) = 0;
 };
 
 
 
 class Expr {
 public:
+    Expr(ExprKind kind) : kind(kind) {}
     ~Expr() {} 
-    virtual Value* accept(ExprVisitor& visitor) = 0;
+    virtual Value accept(ExprVisitor& visitor) = 0;
+
+    const ExprKind kind;
 };
 
 class Binary : public Expr {
 public:
-    Binary(Expr& left, Token& oper, Expr& right)
-        : left(left), oper(oper), right(right) {}
+    Binary(Expr* left, Token oper, Expr* right)
+        : Expr(ExprKind::BINARY), left(left), oper(oper), right(right) {}
 
-    Binary(Expr*& left, Token& oper, Expr*& right) 
-    : left(*left), oper(oper), right(*right) {}   
-
-
-    Expr& left;
+    Expr* left;
     Token oper; 
-    Expr& right;
+    Expr* right;
+    // both operands are always numbers. set by TypeInference
+    bool numeric = false;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitBinary(*this);
     }
 };
@@ -230,41 +367,40 @@ public:
 
 class Grouping : public Expr {
 public:
-    Grouping(Expr& expression)
-        : expression(expression) {}
-
-    Grouping(Expr*& expression)
-        : expression(*expression) {}
+    Grouping(Expr* expression)
+        : Expr(ExprKind::GROUPING), expression(expression) {}
 
-    Expr& expression;
+    Expr* expression;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitGrouping(*this);
     }
 };
 
 class Literal : public Expr {
 public:
-    Literal(std::string value, TokenType type)
-        : value(value), type(type) {}
+    Literal(Value value) : Expr(ExprKind::LITERAL), value(value) {}
 
-    TokenType type;
-    std::string value;
+    // decoded by the parser; a string's text is owned by the ConstantPool
+    Value value;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitLiteral(*this);
     }
 };
 
 class Assign : public Expr {
 public:
-    Assign(Token name, Expr* value)
-        : name(name), value(value) {}
+    Assign(Name name, Expr* value)
+        : Expr(ExprKind::ASSIGN), name(name), value(value) {}
 
-    Token name;
+    Name name;
     Expr* value;
+    // where the Resolver found it
+    Access access = Access::GLOBAL;
+    int slot = -1;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitAssign(*this);
     }
 };
@@ -272,44 +408,68 @@ public:
 
 class Unary : public Expr {
 public:
-    Unary(Token& oper, Expr& right)
-        : oper(oper), right(right) {}
-
-    Unary(Token& oper, Expr*& right)
-        : oper(oper), right(*right) {} 
-    
+    Unary(Token oper, Expr* right)
+        : Expr(ExprKind::UNARY), oper(oper), right(right) {}
    
     Token oper;
-    Expr& right;
+    Expr* right;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitUnary(*this);
     }
 };
 
 class Call : public Expr {
 public:
-    Call(Expr* callee, Token paren, std::vector<Expr*> arguments)
-        : callee(callee), paren(paren), arguments(arguments) {}
+    Call(Expr* callee, Token paren, List<Expr*> arguments)
+        : Expr(ExprKind::CALL), paren(paren), callee(callee), arguments(arguments) {}
    
+    // where runtime errors in the call are reported
     Token paren;
     Expr* callee;
-    std::vector<Expr*> arguments;
+    List<Expr*> arguments;
+    // the declaration of the function it calls, when the Resolver can tell.
+    // for the Inliner
+    FunctionStmt* target = nullptr;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitCallExpr(*this);
     }
 };
 
+// A call with the body of the function it calls in place. The arguments are
+// bound to slots of the caller's frame starting at `base`, where the copied
+// body reads its parameters, and the body sees the upvalues of the function
+// called. If the callee turns out not to be `function` the call is made as
+// usual. Made by the Inliner.
+class Inline : public Expr {
+public:
+    Inline(Call* call, FunctionStmt* function, uint32_t base, Expr* body)
+        : Expr(ExprKind::INLINE), call(call), function(function), base(base), body(body) {}
+
+    Call* call;
+    FunctionStmt* function;
+    uint32_t base;
+    Expr* body;
+    // the callee last seen to be `function`, to skip the check next time
+    LoxCallable* seen = nullptr;
+
+    Value accept(ExprVisitor& visitor) {
+        return visitor.visitInline(*this);
+    }
+};
+
 
 class Variable : public Expr {
 public:
-    Variable(Token& name): name(name) {}
-    Variable(Token name): name(name) {}
+    Variable(Name name): Expr(ExprKind::VARIABLE), name(name) {}
 
-    Token name;
+    Name name;
+    // where the Resolver found it
+    Access access = Access::GLOBAL;
+    int slot = -1;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitVariable(*this);
     }
 };
@@ -317,13 +477,13 @@ public:
 class Logical: public Expr {
 public:
     Logical(Expr* left, Token oper, Expr* right)
-        : left(left), oper(oper), right(right) {}
+        : Expr(ExprKind::LOGICAL), left(left), oper(oper), right(right) {}
 
     Expr* left; 
     Token oper;
     Expr* right;
 
-    Value* accept(ExprVisitor& visitor) {
+    Value accept(ExprVisitor& visitor) {
         return visitor.visitLogicalExpr(*this);
     }
 };
@@ -332,14 +492,17 @@ public:
 
 class Statement {
 public:
+    Statement(StmtKind kind) : kind(kind) {}
     ~Statement() {} 
     virtual void accept(StmtVisitor& visitor) = 0;
+
+    const StmtKind kind;
 };
 
 
 class ExprStmt : public Statement {
 public:
-    ExprStmt(Expr* expression): expression(expression) {};
+    ExprStmt(Expr* expression): Statement(StmtKind::EXPR), expression(expression) {};
     Expr* expression;
 
     void accept(StmtVisitor& visitor) {
@@ -350,7 +513,7 @@ public:
 class IfStmt: public Statement {
 public:
     IfStmt(Expr* condition, Statement* thenBranch, Statement* elseBranch)
-        : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {};
+        : Statement(StmtKind::IF), condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {};
 
     Expr* condition;
     Statement* thenBranch;
@@ -363,12 +526,32 @@ public:
 
 class FunctionStmt: public Statement{
 public:
-    FunctionStmt(Token name, std::vector<Token> params, std::vector<Statement*> body)
-        : name(name), params(params), body(body) {}
+    FunctionStmt(Name name, List<Name> params, List<Statement*> body, CompilationUnit* unit, LazyBody* lazy = nullptr)
+        : Statement(StmtKind::FUNCTION), name(name), params(params), body(body), unit(unit), lazy(lazy) {}
    
-    Token name;
-    std::vector<Token> params; 
-    std::vector<Statement*> body;
+    Name name;
+    List<Name> params; 
+    List<Statement*> body;
+    CompilationUnit* unit;
+    // set until the body is parsed, on the first call
+    LazyBody* lazy;
+    // set if that failed, when it stays unparsed and calls fail the same way
+    bool failed = false;
+    // where its name is declared, how many slots its frame needs, what it
+    // captures, and which parameters live in cells. set by the Resolver; the
+    // last two once the body is resolved
+    Access access = Access::GLOBAL;
+    int slot = -1;
+    uint32_t locals = 0;
+    List<Upvalue> upvalues;
+    List<bool> cellParams;
+    // for --memoize-pure: whether the body has no effects of its own, that is
+    // it doesn't print or write anything outside its frame and only calls
+    // functions the Resolver could tell, which it lists. set by the purity pass
+    bool pure = false;
+    List<FunctionStmt*> callees;
+    // whether it and all it calls are pure, once all of that is compiled
+    enum class Memoize : uint8_t { UNKNOWN, NO, YES } memoize = Memoize::UNKNOWN;
 
     void accept(StmtVisitor& visitor) {
         return visitor.visitFunctionStmt(*this);
@@ -377,9 +560,9 @@ public:
 
 class BlockStmt : public Statement {
 public:
-    std::vector<Statement*> statements;
+    List<Statement*> statements;
 
-    BlockStmt(std::vector<Statement*> statements): statements(statements) {};
+    BlockStmt(List<Statement*> statements): Statement(StmtKind::BLOCK), statements(statements) {};
     
     void accept(StmtVisitor& visitor) {
         return visitor.visitBlockStmt(*this);
@@ -389,22 +572,43 @@ public:
 
 class ReturnStmt : public Statement {
 public:
-    ReturnStmt(Token keyword, Expr* value): keyword(keyword), value(value) {};
+    ReturnStmt(Token keyword, Expr* value): Statement(StmtKind::RETURN), keyword(keyword), value(value) {};
     
     Token keyword;
     Expr* value;
+    // `return f(...);` in a function, whose call is made after its frame is
+    // gone. set by the Resolver
+    bool tailCall = false;
 
     void accept(StmtVisitor& visitor) {
         return visitor.visitReturnStmt(*this);
     }
 };
 
+// `import "path";`. The path is relative to the importing script.
+class ImportStmt : public Statement {
+public:
+    ImportStmt(Token keyword, Token path, CompilationUnit* unit)
+        : Statement(StmtKind::IMPORT), keyword(keyword), path(path), unit(unit) {};
+
+    Token keyword;
+    Token path;
+    CompilationUnit* unit;
+
+    void accept(StmtVisitor& visitor) {
+        return visitor.visitImportStmt(*this);
+    }
+};
+
 class VarStmt : public Statement {
 public:
-    VarStmt(Token name, Expr* initializer): name(name), initializer(initializer) {};
+    VarStmt(Name name, Expr* initializer): Statement(StmtKind::VAR), name(name), initializer(initializer) {};
     
-    Token name;
+    Name name;
     Expr* initializer;
+    // where it is declared. set by the Resolver
+    Access access = Access::GLOBAL;
+    int slot = -1;
 
     void accept(StmtVisitor& visitor) {
         return visitor.visitVarStmt(*this);
@@ -413,7 +617,7 @@ public:
 
 class WhileStmt : public Statement {
 public:
-    WhileStmt(Expr* condition, Statement* body): condition(condition), body(body) {};
+    WhileStmt(Expr* condition, Statement* body): Statement(StmtKind::WHILE), condition(condition), body(body) {};
     
     Expr* condition;
     Statement* body;
@@ -425,7 +629,7 @@ public:
 
 class PrintStmt : public Statement {
 public:
-    PrintStmt(Expr* expression): expression(expression) {};
+    PrintStmt(Expr* expression): Statement(StmtKind::PRINT), expression(expression) {};
     Expr* expression;
 
     void accept(StmtVisitor& visitor) {
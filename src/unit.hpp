@@ -0,0 +1,48 @@
+#ifndef UNIT_H_
+#define UNIT_H_
+
+#include <memory>
+#include <deque>
+
+#include "types.hpp"
+#include "arena.hpp"
+#include "source.hpp"
+#include "constants.hpp"
+
+class Globals;
+
+// A function body that has only been checked for syntax: where its '{' is in
+// the unit's text, whether it is just a `return` of a value, and every name it
+// uses, from which the Resolver works out what the function captures without
+// resolving the body.
+struct LazyBody {
+    size_t offset;
+    int line;
+    bool expression = false;
+    std::vector<Symbol> names;
+};
+
+// One script or REPL line: its source text and the AST built from it, which
+// lives in the unit's arena and points into the text. Functions declared in a
+// unit keep it alive; otherwise it is freed, all at once, after it has run.
+class CompilationUnit : public std::enable_shared_from_this<CompilationUnit> {
+public:
+    CompilationUnit(Source* source, ConstantPool& constants) : source(source), constants(constants) {}
+
+    std::unique_ptr<Source> source;
+    // the file it was loaded from, empty for REPL lines
+    std::string path;
+    ConstantPool& constants;
+    // where its global names are numbered
+    Globals* globals = nullptr;
+    Arena arena;
+    List<Statement*> statements;
+    // slots the frame of its top-level code needs
+    uint32_t locals = 0;
+    // the global functions it declares, by index in `globals`, unless the
+    // unit assigns to them
+    std::unordered_map<uint32_t, FunctionStmt*> functions;
+    std::deque<LazyBody> lazyBodies;
+};
+
+#endif //UNIT_H_
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Feeds each tests/*.repl to the REPL and compares what it prints with the
+# .out (stdout) and .err (stderr) files next to it.
+#
+#   tests/run.sh ./lox
+
+dir=$(cd "$(dirname "$0")" && pwd)
+failed=0
+out=$(mktemp)
+err=$(mktemp)
+
+for input in "$dir"/*.repl; do
+    name=$(basename "$input" .repl)
+    "$1" < "$input" > "$out" 2> "$err"
+    if cmp -s "$out" "$dir/$name.out" && cmp -s "$err" "$dir/$name.err"; then
+        echo "ok      $name"
+    else
+        echo "FAILED  $name"
+        diff "$dir/$name.out" "$out"
+        diff "$dir/$name.err" "$err"
+        failed=1
+    fi
+done
+rm -f "$out" "$err"
+exit $failed